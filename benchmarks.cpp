@@ -1,7 +1,34 @@
+#include <allocators/arena.hpp>
 #include <allocators/balloc.hpp>
+#include <allocators/c_balloc.hpp>
+#include <allocators/chain_balloc.hpp>
+#include <allocators/const_balloc.hpp>
+#include <allocators/frame_balloc.hpp>
+#include <allocators/numa.hpp>
+#include <allocators/pmr_balloc.hpp>
+#include <allocators/pool.hpp>
 #include <allocators/r_balloc.hpp>
+#include <allocators/ring_balloc.hpp>
+#include <allocators/snapshot.hpp>
+#include <allocators/soa.hpp>
+#include <allocators/storage.hpp>
+#include <allocators/tl_balloc.hpp>
+#include <algorithm>
 #include <benchmark.hpp>
 #include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <sched.h>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
 
 struct MyStruct {
     double a;
@@ -36,12 +63,111 @@ void test_down_small() {
     }
 }
 
+void test_up_batch() {
+    BumpUp<sizeof(int) * 10000> b;
+
+    for (int i = 0; i < 120; i++) {
+        while (std::get<0>(b.alloc_batch<int, char, short, char>(1, 1, 1, 1)))
+            ;
+        b.force_dealloc();
+    }
+}
+
+void test_down_batch() {
+    BumpDown<sizeof(int) * 10000> b;
+
+    for (int i = 0; i < 120; i++) {
+        while (std::get<0>(b.alloc_batch<int, char, short, char>(1, 1, 1, 1)))
+            ;
+        b.force_dealloc();
+    }
+}
+
+// A fixed-shape message decoder: a header, a field table and a payload
+struct MessageHeader {
+    uint32_t id;
+    uint16_t num_fields;
+    uint16_t flags;
+};
+
+void test_up_plan() {
+    BumpUp<256> b;
+    for (int i = 0; i < 10000; i++) {
+        MessageHeader *header = b.alloc<MessageHeader>(1);
+        uint16_t *fields = b.alloc<uint16_t>(8);
+        char *payload = b.alloc<char>(64);
+        do_not_optimize(header);
+        do_not_optimize(fields);
+        do_not_optimize(payload);
+        b.force_dealloc();
+    }
+}
+
+void test_static_plan() {
+    StaticArena<256, ArenaSlot<MessageHeader>, ArenaSlot<uint16_t, 8>,
+                ArenaSlot<char, 64>>
+        b;
+    for (int i = 0; i < 10000; i++) {
+        MessageHeader *header = b.get<0>();
+        uint16_t *fields = b.get<1>();
+        char *payload = b.get<2>();
+        do_not_optimize(header);
+        do_not_optimize(fields);
+        do_not_optimize(payload);
+    }
+}
+
+// Advance the positions of a particle system: one field read, one written
+constexpr size_t num_particles = 16384;
+
+struct Particle {
+    float x, y, z;
+    float vx, vy, vz;
+    float mass, charge;
+};
+
+void test_aos_update() {
+    static BumpUp<sizeof(Particle) * num_particles> b;
+    static Particle *particles = [] {
+        Particle *p = b.alloc<Particle>(num_particles);
+        for (size_t i = 0; i < num_particles; i++)
+            p[i] = {0, 0, 0, 1, 1, 1, 1, 0};
+        return p;
+    }();
+    for (int step = 0; step < 10; step++) {
+        for (size_t i = 0; i < num_particles; i++)
+            particles[i].x += particles[i].vx * 0.01f;
+        do_not_optimize(particles);
+    }
+}
+
+void test_soa_update() {
+    static BumpUp<sizeof(Particle) * num_particles + 8 * soa_alignment> b;
+    static auto particles = [] {
+        auto p = alloc_soa<float, float, float, float, float, float, float,
+                           float>(b, num_particles);
+        for (size_t i = 0; i < num_particles; i++) {
+            auto [x, y, z, vx, vy, vz, mass, charge] = p[i];
+            x = y = z = charge = 0;
+            vx = vy = vz = mass = 1;
+        }
+        return p;
+    }();
+    float *x = particles.field<0>().data();
+    float *vx = particles.field<3>().data();
+    for (int step = 0; step < 10; step++) {
+        for (size_t i = 0; i < num_particles; i++)
+            x[i] += vx[i] * 0.01f;
+        do_not_optimize(x);
+    }
+}
+
 void test_up_big() {
     BumpUp<sizeof(int) * 10000> b;
 
     for (int i = 0; i < 120; i++) {
         while (b.alloc<MyStruct>(1))
-            b.alloc<char>(1);
+            do_not_optimize(b.alloc<char>(1));
         b.force_dealloc();
     }
 }
@@ -51,11 +177,241 @@ void test_down_big() {
 
     for (int i = 0; i < 120; i++) {
         while (b.alloc<MyStruct>(1))
+            do_not_optimize(b.alloc<char>(1));
+        b.force_dealloc();
+    }
+}
+
+// Same workload as test_up_small, but starting from a chunk a tenth of the
+// size so the chain has to grow before it reaches steady state
+void test_chain_small() {
+    BumpChain<sizeof(int) * 1000> b;
+
+    for (int i = 0; i < 120; i++) {
+        for (int j = 0; j < 1250; j++) {
+            b.alloc<int>(1);
+            b.alloc<char>(1);
+            b.alloc<short>(1);
+            do_not_optimize(b.alloc<char>(1));
+        }
+        b.force_dealloc();
+    }
+}
+
+void test_up_small_fixed() {
+    BumpUp<sizeof(int) * 10000> b;
+
+    for (int i = 0; i < 120; i++) {
+        for (int j = 0; j < 1250; j++) {
+            b.alloc<int>(1);
             b.alloc<char>(1);
+            b.alloc<short>(1);
+            do_not_optimize(b.alloc<char>(1));
+        }
+        b.force_dealloc();
+    }
+}
+
+constexpr size_t container_arena_size = 1 << 20;
+
+// Arena and buffers for the container benchmarks, reset after every run
+using ContainerArena = BumpUp<container_arena_size>;
+ContainerArena container_arena;
+BumpResource<ContainerArena> bump_resource(container_arena);
+byte monotonic_buffer[container_arena_size];
+
+template <class Vector> void fill_vector(Vector &&v) {
+    for (int i = 0; i < 1000; i++)
+        v.push_back(i);
+    do_not_optimize(v.data());
+}
+
+template <class String> void build_string(String &&str) {
+    for (int i = 0; i < 100; i++)
+        str += "field=value;";
+    do_not_optimize(str.data());
+}
+
+template <class Map> void fill_map(Map &&map) {
+    for (int i = 0; i < 500; i++)
+        map[i] = i;
+    do_not_optimize(&map[0]);
+}
+
+// Runs the container workloads on std::pmr containers using a resource
+void run_pmr_containers(std::pmr::memory_resource *resource) {
+    fill_vector(std::pmr::vector<int>(resource));
+    build_string(std::pmr::string(resource));
+    fill_map(std::pmr::unordered_map<int, int>(resource));
+}
+
+void test_containers_default() {
+    fill_vector(std::vector<int>());
+    build_string(std::string());
+    fill_map(std::unordered_map<int, int>());
+}
+
+void test_containers_bump() {
+    run_pmr_containers(&bump_resource);
+    container_arena.force_dealloc();
+}
+
+void test_containers_monotonic() {
+    std::pmr::monotonic_buffer_resource resource(
+        monotonic_buffer, container_arena_size,
+        std::pmr::null_memory_resource());
+    run_pmr_containers(&resource);
+}
+
+void test_containers_adapter() {
+    using Pair = std::pair<const int, int>;
+    using String = std::basic_string<char, std::char_traits<char>,
+                                     BumpAllocator<char, ContainerArena>>;
+    using Map = std::unordered_map<int, int, std::hash<int>, std::equal_to<int>,
+                                   BumpAllocator<Pair, ContainerArena>>;
+
+    fill_vector(std::vector<int, BumpAllocator<int, ContainerArena>>(
+        BumpAllocator<int, ContainerArena>(container_arena)));
+    build_string(String(BumpAllocator<char, ContainerArena>(container_arena)));
+    fill_map(Map(0, std::hash<int>(), std::equal_to<int>(),
+                 BumpAllocator<Pair, ContainerArena>(container_arena)));
+    container_arena.force_dealloc();
+}
+
+constexpr size_t storage_arena_size = 16 << 20;
+
+// Allocates page sized blocks and writes to each, so every page of the arena
+// is touched once
+template <class Arena> void touch_arena(Arena &b) {
+    while (char *page = b.template alloc<char>(4096)) {
+        page[0] = 1;
+        do_not_optimize(page);
+    }
+}
+
+// Pays for the mapping and the first touch of every page
+template <class Storage> void test_first_touch() {
+    BumpUp<storage_arena_size, Storage> b;
+    touch_arena(b);
+}
+
+// Reuses one arena whose pages are already resident
+template <class Storage> void test_steady_state() {
+    static BumpUp<storage_arena_size, Storage> b;
+    touch_arena(b);
+    b.force_dealloc();
+}
+
+// Requests of 256KB with an 8MB spike every 32, which trimming gives back to
+// the kernel in between and then has to fault in again
+struct SlowTrim : TrimDefaults {
+    static constexpr unsigned decay_shift = 7;
+};
+
+template <class Storage> void test_spiky_requests() {
+    static BumpUp<8 << 20, Storage> b;
+    for (int i = 0; i < 32; i++) {
+        size_t size = i == 0 ? 8 << 20 : 256 << 10;
+        char *p = b.template alloc<char>(size);
+        for (size_t j = 0; j < size; j += 4096)
+            p[j] = 1;
+        do_not_optimize(p);
         b.force_dealloc();
     }
 }
 
+// Writes 16MB into an arena bound to the thread's own node, or to the next
+// one. With a single node both are local.
+constexpr size_t numa_touch_size = 16 << 20;
+using NumaArena =
+    BumpUp<numa_touch_size, NumaStorage<MmapStorage<>, NUMA_BIND>>;
+
+template <int Distance> void test_numa_touch() {
+    static std::unique_ptr<NumaArena> b = [] {
+        NumaPlacement placement((numa_current_node() + Distance) %
+                                numa_node_count());
+        return std::make_unique<NumaArena>();
+    }();
+    char *p = b->alloc<char>(numa_touch_size);
+    std::memset(p, 1, numa_touch_size);
+    do_not_optimize(p);
+    b->force_dealloc();
+}
+
+// Growable buffer that doubles its capacity, as a string builder would
+template <class Arena, class Grow> void grow_buffer(Arena &b, Grow grow) {
+    size_t capacity = 16;
+    char *buffer = b.template alloc<char>(capacity);
+    for (size_t size = 0; size < 60000; size++) {
+        if (size == capacity) {
+            buffer = grow(buffer, capacity, capacity * 2);
+            capacity *= 2;
+        }
+        buffer[size] = 'x';
+    }
+    do_not_optimize(buffer);
+}
+
+BumpUp<1 << 18> grow_up_arena;
+BumpDown<1 << 18> grow_down_arena;
+
+void test_grow_copy() {
+    grow_buffer(grow_up_arena, [](char *buffer, size_t old_n, size_t new_n) {
+        char *moved = grow_up_arena.alloc<char>(new_n);
+        std::memcpy(moved, buffer, old_n);
+        return moved;
+    });
+}
+
+void test_grow_up() {
+    grow_buffer(grow_up_arena, [](char *buffer, size_t old_n, size_t new_n) {
+        return grow_up_arena.realloc(buffer, old_n, new_n);
+    });
+}
+
+void test_grow_down() {
+    grow_buffer(grow_down_arena,
+                [](char *buffer, size_t old_n, size_t new_n) {
+                    return grow_down_arena.realloc(buffer, old_n, new_n);
+                });
+}
+
+// Teardown fixtures, so resetting the arenas is not part of the timing
+void reset_grow_up() { grow_up_arena.force_dealloc(); }
+void reset_grow_down() { grow_down_arena.force_dealloc(); }
+
+constexpr size_t simd_floats = 1 << 14;
+
+// Arena holding the SIMD inputs, with room for the alignment padding
+BumpUp<simd_floats * sizeof(float) * 5> simd_arena;
+float *aligned_x = simd_arena.alloc_aligned<float, 64>(simd_floats);
+float *aligned_y = simd_arena.alloc_aligned<float, 64>(simd_floats);
+// A stray char pushes these off the cache line by one float
+char *simd_pad = simd_arena.alloc<char>(1);
+float *unaligned_x = simd_arena.alloc<float>(simd_floats);
+float *unaligned_y = simd_arena.alloc<float>(simd_floats);
+
+// y = a * x + y, written so the compiler vectorizes it
+void saxpy(float a, const float *x, float *y) {
+    for (size_t i = 0; i < simd_floats; i++)
+        y[i] = a * x[i] + y[i];
+    do_not_optimize(y);
+}
+
+// Same kernel, with the 64 byte alignment promised to the compiler so it can
+// use aligned vector loads and skip the peeling prologue
+void saxpy_aligned(float a, const float *x, float *y) {
+    x = static_cast<const float *>(__builtin_assume_aligned(x, 64));
+    y = static_cast<float *>(__builtin_assume_aligned(y, 64));
+    for (size_t i = 0; i < simd_floats; i++)
+        y[i] = a * x[i] + y[i];
+    do_not_optimize(y);
+}
+
+void test_simd_aligned() { saxpy_aligned(2.0f, aligned_x, aligned_y); }
+
+void test_simd_unaligned() { saxpy(2.0f, unaligned_x, unaligned_y); }
+
 char *old_alignement(char *ptr) {
     char *new_ptr = ptr;
     if (unsigned long remainder = ((unsigned long)ptr % alignof(int))) {
@@ -73,7 +429,7 @@ char *new_alignement(char *ptr) {
 void test_dealloc() {
     BumpDown<1024> b;
     for (int i = 0; i < 400; i++) {
-        b.alloc<int>(256);
+        do_not_optimize(b.alloc<int>(256));
         b.dealloc();
     }
 }
@@ -81,36 +437,505 @@ void test_dealloc() {
 void test_destruct() {
     for (int i = 0; i < 400; i++) {
         BumpDown<1024> b;
-        b.alloc<int>(256);
+        do_not_optimize(b.alloc<int>(256));
+    }
+}
+
+constexpr int concurrent_allocs = 1 << 16;
+
+// Shared arenas for the scaling benchmarks, big enough that no thread count
+// runs out of space before the work is done
+ConcurrentBumpUp<concurrent_allocs * sizeof(int) * 2> concurrent_arena;
+BumpUp<concurrent_allocs * sizeof(int) * 2> mutex_arena;
+std::mutex arena_mutex;
+
+// Splits a fixed amount of allocations over the given number of threads
+template <class Work> void run_threads(int num_threads, Work work) {
+    std::vector<std::thread> threads;
+    for (int t = 0; t < num_threads; t++)
+        threads.emplace_back(work, concurrent_allocs / num_threads);
+    for (std::thread &thread : threads)
+        thread.join();
+}
+
+// Thread counts to scale over: doubling from one, and always ending with
+// every hardware thread, at least two, even if that is not a power of two
+std::vector<int> thread_counts() {
+    int max_threads = std::max(2u, std::thread::hardware_concurrency());
+    std::vector<int> counts;
+    for (int t = 1; t < max_threads; t *= 2)
+        counts.push_back(t);
+    counts.push_back(max_threads);
+    return counts;
+}
+
+void test_concurrent_up(int num_threads) {
+    run_threads(num_threads, [](int allocs) {
+        for (int i = 0; i < allocs; i += 2) {
+            concurrent_arena.alloc<char>(1);
+            concurrent_arena.alloc<int>(1);
+        }
+    });
+}
+
+void test_mutex_up(int num_threads) {
+    run_threads(num_threads, [](int allocs) {
+        for (int i = 0; i < allocs; i += 2) {
+            std::lock_guard<std::mutex> lock(arena_mutex);
+            mutex_arena.alloc<char>(1);
+            mutex_arena.alloc<int>(1);
+        }
+    });
+}
+
+void reset_concurrent_arenas() {
+    concurrent_arena.force_dealloc();
+    mutex_arena.force_dealloc();
+}
+
+// Every thread allocates batches of small objects and frees them again,
+// which with per-thread arenas resets the arena after every batch
+ThreadArenas<BumpUp<1 << 16>> thread_arenas;
+
+void test_thread_arenas(int num_threads) {
+    run_threads(num_threads, [](int allocs) {
+        void *batch[64];
+        for (int i = 0; i < allocs; i += 64) {
+            for (int j = 0; j < 64; j++)
+                batch[j] = thread_arenas.alloc_bytes(j % 2 ? 48 : 16, 16);
+            do_not_optimize(batch);
+            for (int j = 0; j < 64; j++)
+                thread_arenas.dealloc(batch[j]);
+        }
+    });
+}
+
+void test_thread_malloc(int num_threads) {
+    run_threads(num_threads, [](int allocs) {
+        void *batch[64];
+        for (int i = 0; i < allocs; i += 64) {
+            for (int j = 0; j < 64; j++)
+                batch[j] = std::malloc(j % 2 ? 48 : 16);
+            do_not_optimize(batch);
+            for (int j = 0; j < 64; j++)
+                std::free(batch[j]);
+        }
+    });
+}
+
+void test_destruct_inline() {
+    for (int i = 0; i < 400; i++) {
+        InlineArena<1024> b;
+        do_not_optimize(b.alloc<int>(256));
+    }
+}
+
+void test_destruct_caller() {
+    byte buffer[1024];
+    for (int i = 0; i < 400; i++) {
+        Arena b(buffer, sizeof(buffer));
+        do_not_optimize(b.alloc<int>(256));
     }
 }
 
-int main() {
+// Sessions that keep replacing a fixed number of live objects of mixed sizes
+const size_t churn_sizes[] = {24, 40, 100, 16};
+
+BumpUp<1 << 20> pool_arena;
+SizeClassPool<BumpUp<1 << 20>, 16, 32, 48, 64, 128> churn_pool(pool_arena);
+
+void test_pool_churn() {
+    void *live[64] = {};
+    for (int i = 0; i < 20000; i++) {
+        int slot = i % 64;
+        size_t size = churn_sizes[(i / 64) % 4];
+        if (live[slot])
+            churn_pool.deallocate(live[slot], churn_sizes[(i / 64 + 3) % 4]);
+        live[slot] = churn_pool.allocate(size);
+        do_not_optimize(live[slot]);
+    }
+    churn_pool.force_dealloc();
+}
+
+void test_malloc_churn() {
+    void *live[64] = {};
+    for (int i = 0; i < 20000; i++) {
+        int slot = i % 64;
+        std::free(live[slot]);
+        live[slot] = std::malloc(churn_sizes[(i / 64) % 4]);
+        do_not_optimize(live[slot]);
+    }
+    for (void *p : live)
+        std::free(p);
+}
+
+// A request loop where every request fills 64KB that is scrubbed afterwards,
+// by the request thread or by the ring's worker thread
+constexpr size_t request_bytes = 64 << 10;
+
+template <class Arena> void build_request(Arena &b) {
+    char *p = b.template alloc<char>(request_bytes);
+    std::memset(p, 1, request_bytes);
+    do_not_optimize(p);
+}
+
+BumpUp<request_bytes> request_arena;
+FrameRing<BumpUp<request_bytes>, 4, FrameScrub> request_ring(true);
+
+void test_inline_scrub() {
+    for (int i = 0; i < 32; i++) {
+        build_request(request_arena);
+        FrameScrub::release(request_arena.data(), request_arena.used());
+        request_arena.force_dealloc();
+    }
+}
+
+void test_ring_scrub() {
+    for (int i = 0; i < 32; i++) {
+        auto &frame = request_ring.next();
+        build_request(frame);
+        request_ring.release(frame);
+    }
+}
+
+// A stream of messages of varying sizes, each freed 64 messages later
+RingBump<1 << 16> message_ring;
+
+void test_ring_fifo() {
+    for (int i = 0; i < 20000; i++) {
+        if (i >= 64)
+            message_ring.release();
+        do_not_optimize(message_ring.alloc_bytes(churn_sizes[i % 4] * 2, 8));
+    }
+    message_ring.force_dealloc();
+}
+
+void test_malloc_fifo() {
+    void *window[64] = {};
+    for (int i = 0; i < 20000; i++) {
+        std::free(window[i % 64]);
+        window[i % 64] = std::malloc(churn_sizes[i % 4] * 2);
+        do_not_optimize(window[i % 64]);
+    }
+    for (void *p : window)
+        std::free(p);
+}
+
+// A chained hash table of 2^18 entries, as a worker would build on startup,
+// either rebuilt every time or mapped from a snapshot and used in place
+constexpr size_t table_entries = 1 << 18;
+constexpr size_t table_buckets = 1 << 16;
+
+struct TableEntry {
+    uint64_t key;
+    uint64_t value;
+    arena_ptr<TableEntry> next;
+};
+
+struct Table {
+    arena_ptr<TableEntry> buckets[table_buckets];
+};
+
+using TableArena = BumpUp<sizeof(Table) + sizeof(TableEntry) * table_entries,
+                          MmapStorage<>>;
+const char *table_snapshot = "benchmark_table.snap";
+
+size_t table_bucket(uint64_t key) {
+    return (key * 0x9E3779B97F4A7C15u) >> 48;
+}
+
+Table *build_table(TableArena &b) {
+    Table *table = b.make<Table>();
+    for (uint64_t i = 0; i < table_entries; i++) {
+        TableEntry *entry = b.make<TableEntry>();
+        entry->key = i * 7;
+        entry->value = i;
+        entry->next = table->buckets[table_bucket(entry->key)];
+        table->buckets[table_bucket(entry->key)] = entry;
+    }
+    return table;
+}
+
+uint64_t lookup_table(const Table *table) {
+    uint64_t sum = 0;
+    for (uint64_t i = 0; i < 1000; i++) {
+        uint64_t key = i * 7919 % table_entries * 7;
+        const TableEntry *entry = table->buckets[table_bucket(key)].get();
+        while (entry && entry->key != key)
+            entry = entry->next.get();
+        sum += entry ? entry->value : 0;
+    }
+    return sum;
+}
+
+void test_rebuild_table() {
+    static TableArena b;
+    do_not_optimize(lookup_table(build_table(b)));
+    b.force_dealloc();
+}
+
+void test_load_table() {
+    static bool saved = [] {
+        TableArena b;
+        return save_snapshot(b, build_table(b), table_snapshot);
+    }();
+    Snapshot snapshot(table_snapshot);
+    if (saved && snapshot)
+        do_not_optimize(lookup_table(snapshot.root<Table>()));
+}
+
+int main(int argc, char **argv) {
+    const char *csv_path = nullptr;
+    const char *json_path = nullptr;
+    const char *baseline_path = nullptr;
+    double tolerance = 0.05;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (i + 1 < argc && arg == "--csv") {
+            csv_path = argv[++i];
+        } else if (i + 1 < argc && arg == "--json") {
+            json_path = argv[++i];
+        } else if (i + 1 < argc && arg == "--baseline") {
+            baseline_path = argv[++i];
+        } else if (i + 1 < argc && arg == "--tolerance") {
+            tolerance = std::atof(argv[++i]) / 100;
+        } else {
+            std::cerr << "usage: " << argv[0]
+                      << " [--csv FILE] [--json FILE] [--baseline FILE]"
+                         " [--tolerance PERCENT]"
+                      << std::endl;
+            return 2;
+        }
+    }
+
+    BenchmarkReport report;
     {
         Benchmark b(5000);
+        b.warmup(500).counters();
         b.benchmark("up small obj", test_up_small);
         b.benchmark("down small obj", test_down_small);
+        b.benchmark("up batch", test_up_batch);
+        b.benchmark("down batch", test_down_batch);
+        b.print();
+        report.add(b);
+    }
+    {
+        Benchmark b(5000);
+        b.warmup(500);
+        b.benchmark("up plan", test_up_plan);
+        b.benchmark("static plan", test_static_plan);
+        b.print();
+        report.add(b);
+    }
+    {
+        Benchmark b(2000);
+        b.warmup(200).counters();
+        b.benchmark("aos update", test_aos_update);
+        b.benchmark("soa update", test_soa_update);
         b.print();
+        report.add(b);
     }
     {
         Benchmark b(5000);
+        b.warmup(500).counters();
         b.benchmark("up big obj", test_up_big);
         b.benchmark("down big obj", test_down_big);
         b.print();
+        report.add(b);
+    }
+    {
+        Benchmark b(1000);
+        b.warmup(100);
+        b.benchmark("up fixed", test_up_small_fixed);
+        b.benchmark("chain growing", test_chain_small);
+        b.print();
+        report.add(b);
+    }
+    {
+        Benchmark b(1000);
+        b.warmup(100);
+        b.benchmark("std default", test_containers_default);
+        b.benchmark("pmr bump", test_containers_bump);
+        b.benchmark("pmr monotonic", test_containers_monotonic);
+        b.benchmark("bump adapter", test_containers_adapter);
+        b.print();
+        report.add(b);
+    }
+    {
+        Benchmark b(50);
+        b.warmup(5).counters();
+        b.benchmark("heap touch", test_first_touch<HeapStorage>);
+        b.benchmark("mmap touch", test_first_touch<MmapStorage<>>);
+        b.benchmark("thp touch", test_first_touch<MmapStorage<MMAP_HUGE_PAGES>>);
+        b.benchmark("populate touch",
+                    test_first_touch<MmapStorage<MMAP_POPULATE>>);
+        b.benchmark("hugetlb touch", test_first_touch<MmapStorage<MMAP_HUGETLB>>);
+        b.print();
+        report.add(b);
+    }
+    {
+        Benchmark b(50);
+        b.warmup(5);
+        b.benchmark("heap reuse", test_steady_state<HeapStorage>);
+        b.benchmark("mmap reuse", test_steady_state<MmapStorage<>>);
+        b.benchmark("thp reuse",
+                    test_steady_state<MmapStorage<MMAP_HUGE_PAGES>>);
+        b.benchmark("populate reuse",
+                    test_steady_state<MmapStorage<MMAP_POPULATE>>);
+        b.benchmark("hugetlb reuse",
+                    test_steady_state<MmapStorage<MMAP_HUGETLB>>);
+        b.print();
+        report.add(b);
+    }
+    {
+        Benchmark b(200);
+        b.warmup(20).counters();
+        b.benchmark("mmap spiky", test_spiky_requests<MmapStorage<>>);
+        b.benchmark("trim spiky", test_spiky_requests<Trimming<>>);
+        b.benchmark("slow spiky",
+                    test_spiky_requests<Trimming<MmapStorage<>, SlowTrim>>);
+        b.print();
+        report.add(b);
+    }
+    {
+        // Stay on one CPU, so local and remote keep meaning the same nodes
+        cpu_set_t allowed, pinned;
+        sched_getaffinity(0, sizeof(allowed), &allowed);
+        CPU_ZERO(&pinned);
+        CPU_SET(sched_getcpu(), &pinned);
+        sched_setaffinity(0, sizeof(pinned), &pinned);
+
+        Benchmark b(200);
+        b.warmup(20).counters();
+        b.benchmark("local touch", test_numa_touch<0>);
+        b.benchmark("remote touch", test_numa_touch<1>);
+        b.print();
+        report.add(b);
+
+        sched_setaffinity(0, sizeof(allowed), &allowed);
+    }
+    {
+        Benchmark b(1000);
+        b.warmup(100);
+        b.benchmark_fixture("grow copy", [] {}, test_grow_copy, reset_grow_up);
+        b.benchmark_fixture("grow up", [] {}, test_grow_up, reset_grow_up);
+        b.benchmark_fixture("grow down", [] {}, test_grow_down,
+                            reset_grow_down);
+        b.print();
+        report.add(b);
     }
     {
         Benchmark b(5000);
+        b.warmup(500);
+        b.benchmark("simd aligned", test_simd_aligned);
+        b.benchmark("simd unaligned", test_simd_unaligned);
+        b.print();
+        report.add(b);
+    }
+    {
+        // Too fast for the clock to see one call, so time them in batches
+        Benchmark b(5000);
+        b.warmup(500).batch(1000).cycles();
         b.benchmark("new alignement", new_alignement,
                     reinterpret_cast<char *>(0x12345678));
         b.benchmark("old alignement", old_alignement,
                     reinterpret_cast<char *>(0x12345678));
         b.print();
+        report.add(b);
     }
     {
         Benchmark b(5000);
+        b.warmup(500);
         b.benchmark("dealloc", test_dealloc);
         b.benchmark("destructor", test_destruct);
+        b.benchmark("inline scope", test_destruct_inline);
+        b.benchmark("caller scope", test_destruct_caller);
+        b.print();
+        report.add(b);
+    }
+    {
+        Benchmark b(1000);
+        b.warmup(100);
+        b.benchmark("malloc churn", test_malloc_churn);
+        b.benchmark("pool churn", test_pool_churn);
+        b.print();
+        report.add(b);
+    }
+    {
+        Benchmark b(1000);
+        b.warmup(100);
+        b.benchmark("inline scrub", test_inline_scrub);
+        b.benchmark("ring scrub", test_ring_scrub);
+        b.print();
+        report.add(b);
+    }
+    {
+        Benchmark b(1000);
+        b.warmup(100);
+        b.benchmark("malloc fifo", test_malloc_fifo);
+        b.benchmark("ring fifo", test_ring_fifo);
+        b.print();
+        report.add(b);
+    }
+    {
+        Benchmark b(200);
+        b.warmup(20);
+        b.benchmark("rebuild table", test_rebuild_table);
+        b.benchmark("load table", test_load_table);
+        b.print();
+        report.add(b);
+        std::remove(table_snapshot);
+    }
+    {
+        // Benchmark only keeps the name pointers, so the labels must outlive it
+        std::deque<std::string> labels;
+        Benchmark b(200);
+        b.warmup(20);
+        for (int t : thread_counts()) {
+            labels.push_back("mutex " + std::to_string(t) + "t");
+            b.benchmark_fixture(labels.back().c_str(), [] {}, test_mutex_up,
+                                reset_concurrent_arenas, t);
+            labels.push_back("atomic " + std::to_string(t) + "t");
+            b.benchmark_fixture(labels.back().c_str(), [] {},
+                                test_concurrent_up, reset_concurrent_arenas, t);
+        }
         b.print();
+        report.add(b);
+    }
+    {
+        std::deque<std::string> labels;
+        Benchmark b(200);
+        b.warmup(20);
+        for (int t : thread_counts()) {
+            labels.push_back("malloc " + std::to_string(t) + "t");
+            b.benchmark(labels.back().c_str(), test_thread_malloc, t);
+            labels.push_back("arenas " + std::to_string(t) + "t");
+            b.benchmark(labels.back().c_str(), test_thread_arenas, t);
+        }
+        b.print();
+        report.add(b);
+    }
+
+    if (csv_path) {
+        std::ofstream out(csv_path);
+        report.write_csv(out);
+    }
+    if (json_path) {
+        std::ofstream out(json_path);
+        report.write_json(out);
+    }
+    if (baseline_path) {
+        std::ifstream baseline(baseline_path);
+        if (!baseline) {
+            std::cerr << "cannot read baseline " << baseline_path << std::endl;
+            return 2;
+        }
+        int regressions = report.compare(baseline, tolerance);
+        if (regressions) {
+            std::cout << regressions << " benchmark(s) regressed" << std::endl;
+            return 1;
+        }
     }
 
     return 0;
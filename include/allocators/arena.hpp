@@ -0,0 +1,256 @@
+#pragma once
+
+/**
+ * @file arena.hpp
+ * @brief Defines the Arena and InlineArena classes, bump-pointer allocators
+ * whose capacity is chosen at runtime.
+ */
+
+#include <array>   // For std::array
+#include <cstddef> // For size_t
+#include <cstdint> // For uintptr_t
+
+using std::byte;
+
+/**
+ * @class Arena
+ * @brief A bump-pointer allocator whose buffer size is a runtime value.
+ *
+ * The buffer can be supplied by the caller, in which case constructing the
+ * arena allocates nothing, or owned by the arena on the heap. Unlike BumpUp
+ * the class is not a template, so every capacity shares one copy of the code.
+ *
+ * An arena can also be told to spill: once its buffer is full, further
+ * allocations go to heap chunks instead of failing. InlineArena uses this to
+ * keep small scopes entirely on the stack.
+ */
+class Arena {
+  public:
+    /**
+     * @brief Constructs an arena over a buffer owned by the caller.
+     * @param buffer Start of the buffer, which must outlive the arena.
+     * @param size Number of bytes in the buffer.
+     * @param spill Whether to continue in heap chunks once the buffer is full.
+     */
+    Arena(byte *buffer, size_t size, bool spill = false) {
+        init(buffer, size, spill);
+        owned = nullptr;
+    }
+
+    /**
+     * @brief Constructs an arena that owns a heap buffer of the given size.
+     * @param size Number of bytes in the buffer.
+     * @param spill Whether to continue in heap chunks once the buffer is full.
+     */
+    explicit Arena(size_t size, bool spill = false) {
+        owned = new byte[size];
+        init(owned, size, spill);
+    }
+
+    Arena(const Arena &) = delete;
+    Arena &operator=(const Arena &) = delete;
+
+    /**
+     * @brief Allocates memory for an array of elements of type T.
+     *
+     * @tparam T The type of elements to allocate.
+     * @param n Number of elements to allocate space for.
+     * @returns A pointer to the allocated memory, or nullptr if allocation
+     * fails.
+     */
+    template <class T> T *alloc(size_t n) {
+        return reinterpret_cast<T *>(alloc_bytes(sizeof(T) * n, alignof(T)));
+    }
+
+    /**
+     * @brief Allocates raw memory with the given size and alignment.
+     *
+     * @param size Number of bytes to allocate.
+     * @param alignment Alignment of the returned pointer, must be a power of
+     * two.
+     * @returns A pointer to the allocated memory, or nullptr if allocation
+     * fails and the arena does not spill.
+     */
+    byte *alloc_bytes(size_t size, size_t alignment) {
+        // Calculate the aligned memory location
+        byte *aligned = reinterpret_cast<byte *>(
+            (reinterpret_cast<uintptr_t>(ptr) - 1u + alignment) & -alignment);
+
+        // Calculate the new pointer after the allocation
+        byte *new_ptr = aligned + size;
+
+        // Check if the allocation exceeds the available memory
+        if (new_ptr > end) {
+            return spill ? alloc_spill(size, alignment) : nullptr;
+        }
+
+        // Update the current pointer to the new position
+        ptr = new_ptr;
+
+        // Increment the global allocation counter
+        num_allocations++;
+
+        // Return the aligned pointer to the allocated memory
+        return aligned;
+    }
+
+    /**
+     * @brief Gets the total number of allocations made using this allocator.
+     * @return The number of allocations.
+     */
+    int get_num_allocations() { return num_allocations; }
+
+    /**
+     * @brief Gets the number of times force_dealloc() has emptied the
+     * allocator, so code holding on to its memory can tell it was reset.
+     * @return The number of resets since construction.
+     */
+    unsigned get_num_resets() { return num_resets; }
+
+    /**
+     * @brief Gets the size of the arena's own buffer.
+     * @return The capacity in bytes, not counting spilled chunks.
+     */
+    size_t capacity() { return buffer_end - buffer; }
+
+    /**
+     * @brief Checks whether any allocation has gone to a heap chunk.
+     */
+    bool has_spilled() { return spilled != nullptr; }
+
+    /**
+     * @brief Deallocates memory for objects of type T.
+     * If the number of allocations becomes zero, forces deallocation of all
+     * memory.
+     */
+    void dealloc() {
+        if (--num_allocations == 0)
+            force_dealloc();
+    }
+
+    /**
+     * @brief Forces deallocation of all memory.
+     *
+     * Rewinds to the arena's own buffer. Spilled chunks are kept and reused by
+     * the next round that overflows.
+     */
+    void force_dealloc() {
+        current = nullptr;
+        ptr = buffer;
+        end = buffer_end;
+        num_allocations = 0;
+        num_resets++;
+    }
+
+    /**
+     * @brief Destructor for the Arena class.
+     * Deallocates the owned buffer and any spilled chunks.
+     */
+    ~Arena() {
+        while (spilled) {
+            Chunk *next = spilled->next;
+            delete[] reinterpret_cast<byte *>(spilled);
+            spilled = next;
+        }
+        delete[] owned;
+    }
+
+  private:
+    /**
+     * @brief Header placed at the start of every spilled chunk.
+     */
+    struct Chunk {
+        Chunk *next; ///< Next spilled chunk.
+        byte *end;   ///< End of this chunk's memory.
+
+        /**
+         * @brief Gets the first usable byte after the header.
+         */
+        byte *data() { return reinterpret_cast<byte *>(this + 1); }
+    };
+
+    /**
+     * @brief Sets up the bump pointer over the arena's own buffer.
+     */
+    void init(byte *start, size_t size, bool spill_enabled) {
+        buffer = start;
+        buffer_end = start + size;
+        ptr = buffer;
+        end = buffer_end;
+        spill = spill_enabled;
+        spilled = nullptr;
+        current = nullptr;
+        num_allocations = 0;
+        num_resets = 0;
+    }
+
+    /**
+     * @brief Serves an allocation that did not fit, from a heap chunk.
+     */
+    byte *alloc_spill(size_t size, size_t alignment) {
+        size_t needed = size + alignment - 1;
+        Chunk **link = current ? &current->next : &spilled;
+
+        // Reuse the next cached chunk if it is big enough, otherwise put a
+        // new one in front of it, at least twice the size of the last
+        Chunk *chunk = *link;
+        if (!chunk || (size_t)(chunk->end - chunk->data()) < needed) {
+            size_t last = current ? current->end - current->data()
+                                  : capacity();
+            size_t chunk_size = last * 2 > needed ? last * 2 : needed;
+            chunk = reinterpret_cast<Chunk *>(
+                new byte[sizeof(Chunk) + chunk_size]);
+            chunk->next = *link;
+            chunk->end = chunk->data() + chunk_size;
+            *link = chunk;
+        }
+        current = chunk;
+
+        byte *aligned = reinterpret_cast<byte *>(
+            (reinterpret_cast<uintptr_t>(chunk->data()) - 1u + alignment) &
+            -alignment);
+        ptr = aligned + size;
+        end = chunk->end;
+        num_allocations++;
+        return aligned;
+    }
+
+    byte *buffer;        ///< Start of the arena's own buffer.
+    byte *buffer_end;    ///< End of the arena's own buffer.
+    byte *owned;         ///< Buffer to delete, if the arena owns one.
+    byte *ptr;           ///< Current bump pointer position.
+    byte *end;           ///< End of the buffer or chunk being used.
+    Chunk *spilled;      ///< Heap chunks used after the buffer filled up.
+    Chunk *current;      ///< Spilled chunk in use, nullptr while in buffer.
+    bool spill;          ///< Whether to spill instead of failing.
+    int num_allocations; ///< Number of active allocations.
+    unsigned num_resets; ///< Number of calls to force_dealloc().
+};
+
+/**
+ * @brief Holds the inline buffer of an InlineArena.
+ *
+ * Kept as a separate base so that the buffer exists before the Arena base is
+ * constructed over it.
+ */
+template <size_t N> struct InlineBuffer {
+    alignas(std::max_align_t) std::array<byte, N> inline_buffer;
+};
+
+/**
+ * @class InlineArena
+ * @brief An Arena whose first N bytes live inside the object itself.
+ * @tparam N The size of the inline buffer.
+ *
+ * Declared as a local variable the buffer sits on the stack, so a scope that
+ * stays under N bytes never touches the system allocator. Once the buffer is
+ * full the arena spills into heap chunks instead of failing.
+ */
+template <size_t N>
+class InlineArena : private InlineBuffer<N>, public Arena {
+  public:
+    /**
+     * @brief Constructor for the InlineArena class.
+     */
+    InlineArena() : Arena(this->inline_buffer.data(), N, true) {}
+};
@@ -6,8 +6,18 @@
  * allocation.
  */
 
-#include <cstddef> // For size_t
-#include <cstdint> // For uintptr_t
+#include <cstddef>     // For size_t
+#include <cstdint>     // For uintptr_t
+#include <cstring>     // For std::memcpy
+#include <new>         // For placement new
+#include <tuple>       // For std::tuple
+#include <type_traits> // For std::is_trivially_destructible_v
+#include <utility>     // For std::forward
+
+#include "batch.hpp"       // For BatchLayout
+#include "destructors.hpp" // For DestructorList
+#include "stats.hpp"       // For NoStats
+#include "storage.hpp"     // For HeapStorage
 
 using std::byte;
 
@@ -16,18 +26,34 @@ using std::byte;
  * @brief A simple bump-pointer allocator for memory allocation and
  * deallocation.
  * @tparam S The size of the memory buffer to be allocated.
+ * @tparam Storage Policy providing the buffer, such as HeapStorage or
+ * MmapStorage.
+ * @tparam Stats Policy recording usage statistics, NoStats or BumpStats. Its
+ * public members, such as BumpStats::snapshot(), are available on the
+ * allocator.
  */
-template <size_t S> class BumpUp {
+template <size_t S, class Storage = HeapStorage, class Stats = NoStats>
+class BumpUp : public Stats {
   public:
+    /**
+     * @brief A saved position of the bump pointer, see mark() and rewind().
+     */
+    struct Checkpoint {
+        byte *ptr;                          ///< Bump pointer position.
+        int num_allocations;                ///< Number of allocations.
+        DestructorList::Entry *destructors; ///< Newest destructor entry.
+    };
+
     /**
      * @brief Constructor for the BumpUp class.
      * Initializes the memory buffer and the bump pointer.
      */
-    BumpUp() {
-        start = new byte[S];
+    BumpUp() : storage(S) {
+        start = storage.data();
         ptr = start;
         end = start + S;
         num_allocations = 0;
+        num_resets = 0;
     }
 
     /**
@@ -47,12 +73,23 @@ template <size_t S> class BumpUp {
      * alignment for the allocated memory.
      */
     template <class T> T *alloc(size_t n) {
-        // Calculate the size needed for the allocation
-        size_t size = sizeof(T) * n;
-
-        // Calculate the alignment value for type T
-        size_t alignment = alignof(T);
+        return reinterpret_cast<T *>(alloc_bytes(sizeof(T) * n, alignof(T)));
+    }
 
+    /**
+     * @brief Allocates raw memory with the given size and alignment.
+     *
+     * @param size Number of bytes to allocate.
+     * @param alignment Alignment of the returned pointer, must be a power of
+     * two.
+     * @returns A pointer to the allocated memory, or nullptr if allocation
+     * fails.
+     *
+     * This is the type-erased form of alloc, used by adapters such as
+     * BumpResource that only know the size and alignment of a request. When
+     * called from alloc the alignment is a constant and folds into the mask.
+     */
+    byte *alloc_bytes(size_t size, size_t alignment) {
         // Calculate the aligned memory location
         byte *aligned = reinterpret_cast<byte *>(
             (reinterpret_cast<uintptr_t>(ptr) - 1u + alignment) & -alignment);
@@ -62,9 +99,13 @@ template <size_t S> class BumpUp {
 
         // Check if the allocation exceeds the available memory
         if (new_ptr > end) {
+            this->record_failure(size);
             return nullptr;
         }
 
+        // Record the allocation, if the stats policy wants it
+        this->record_alloc(size, aligned - ptr, new_ptr - start);
+
         // Update the current pointer to the new position
         ptr = new_ptr;
 
@@ -72,7 +113,237 @@ template <size_t S> class BumpUp {
         num_allocations++;
 
         // Return the aligned pointer to the allocated memory
-        return reinterpret_cast<T *>(aligned);
+        return aligned;
+    }
+
+    /**
+     * @brief Allocates raw memory with an alignment known at compile time.
+     *
+     * @tparam Alignment Alignment of the returned pointer, must be a power of
+     * two.
+     * @param size Number of bytes to allocate.
+     * @returns A pointer to the allocated memory, or nullptr if allocation
+     * fails.
+     */
+    template <size_t Alignment> byte *alloc_bytes(size_t size) {
+        static_assert(Alignment && !(Alignment & (Alignment - 1)),
+                      "alignment must be a power of two");
+        return alloc_bytes(size, Alignment);
+    }
+
+    /**
+     * @brief Allocates memory for n elements of type T with a stricter
+     * alignment than alignof(T), known at compile time.
+     *
+     * @tparam T The type of elements to allocate.
+     * @tparam Alignment Alignment of the returned pointer, such as 64 for a
+     * cache line or 4096 for a page.
+     * @param n Number of elements to allocate space for.
+     * @returns A pointer to the allocated memory, or nullptr if allocation
+     * fails.
+     *
+     * The alignment folds into the same branchless mask alloc uses.
+     */
+    template <class T, size_t Alignment> T *alloc_aligned(size_t n) {
+        constexpr size_t alignment =
+            Alignment > alignof(T) ? Alignment : alignof(T);
+        return reinterpret_cast<T *>(alloc_bytes<alignment>(sizeof(T) * n));
+    }
+
+    /**
+     * @brief Allocates memory for n elements of type T with an alignment only
+     * known at runtime.
+     *
+     * @tparam T The type of elements to allocate.
+     * @param n Number of elements to allocate space for.
+     * @param alignment Alignment of the returned pointer. Values below
+     * alignof(T) are raised to it.
+     * @returns A pointer to the allocated memory, or nullptr if allocation
+     * fails or the alignment is not a power of two.
+     */
+    template <class T> T *alloc_aligned(size_t n, size_t alignment) {
+        if (!alignment || (alignment & (alignment - 1)))
+            return nullptr;
+        if (alignment < alignof(T))
+            alignment = alignof(T);
+        return reinterpret_cast<T *>(alloc_bytes(sizeof(T) * n, alignment));
+    }
+
+    /**
+     * @brief Allocates arrays of several types with a single bounds check.
+     *
+     * @tparam Ts The element types of the arrays.
+     * @param n Number of elements of each type, in the same order.
+     * @returns A tuple with a pointer to each array, or a tuple of nullptrs
+     * if the batch does not fit.
+     *
+     * The arrays share one block laid out by BatchLayout, most aligned type
+     * first, so only the block itself needs aligning and nothing is padded in
+     * between. The block is a single allocation: one bounds check, one bump
+     * and one count, freed with a single dealloc().
+     *
+     * ```cpp
+     * auto [node, key, tag] = arena.alloc_batch<Node, char, short>(1, 16, 1);
+     * ```
+     */
+    template <class... Ts>
+    std::tuple<Ts *...> alloc_batch(std::conditional_t<true, size_t, Ts>... n) {
+        using Layout = BatchLayout<Ts...>;
+        size_t offsets[Layout::count];
+        size_t size = Layout::place({sizeof(Ts) * n...}, offsets);
+        return Layout::pointers(alloc_bytes(size, Layout::alignment), offsets);
+    }
+
+    /**
+     * @brief Grows or shrinks an allocation without moving it.
+     *
+     * @tparam T The type of elements.
+     * @param p The allocation to resize.
+     * @param old_n Number of elements p was allocated with.
+     * @param new_n Number of elements wanted.
+     * @returns true if p now holds new_n elements.
+     *
+     * Growing only works for the most recent allocation, which is extended by
+     * moving the bump pointer forward. Shrinking always succeeds.
+     */
+    template <class T> bool try_extend(T *p, size_t old_n, size_t new_n) {
+        if (new_n <= old_n) {
+            shrink(p, old_n, new_n);
+            return true;
+        }
+
+        // Only the allocation ending at the bump pointer can grow
+        if (reinterpret_cast<byte *>(p + old_n) != ptr)
+            return false;
+
+        byte *new_ptr = reinterpret_cast<byte *>(p) + sizeof(T) * new_n;
+        if (new_ptr > end)
+            return false;
+
+        ptr = new_ptr;
+        this->record_resize(ptr - start);
+        return true;
+    }
+
+    /**
+     * @brief Shrinks an allocation in place.
+     *
+     * @tparam T The type of elements.
+     * @param p The allocation to shrink.
+     * @param old_n Number of elements p was allocated with.
+     * @param new_n Number of elements to keep, no more than old_n.
+     *
+     * If p is the most recent allocation the freed tail is given back to the
+     * allocator, otherwise it stays unused until the next reset.
+     */
+    template <class T> void shrink(T *p, size_t old_n, size_t new_n) {
+        if (reinterpret_cast<byte *>(p + old_n) == ptr)
+            ptr = reinterpret_cast<byte *>(p + new_n);
+    }
+
+    /**
+     * @brief Resizes an allocation, moving it if it cannot grow in place.
+     *
+     * @tparam T The type of elements, must be trivially copyable.
+     * @param p The allocation to resize, or nullptr to allocate.
+     * @param old_n Number of elements p was allocated with.
+     * @param new_n Number of elements wanted.
+     * @param alignment Alignment to keep, the one p was allocated with when
+     * it came from alloc_aligned(). A power of two, at least alignof(T).
+     * @returns A pointer to the resized allocation, or nullptr if there is not
+     * enough memory, in which case p is left untouched.
+     *
+     * The allocation counter is not changed, since the result replaces p.
+     */
+    template <class T>
+    T *realloc(T *p, size_t old_n, size_t new_n,
+               size_t alignment = alignof(T)) {
+        static_assert(std::is_trivially_copyable_v<T>,
+                      "realloc moves elements with memcpy");
+
+        if (!p)
+            return reinterpret_cast<T *>(
+                alloc_bytes(sizeof(T) * new_n, alignment));
+        if (try_extend(p, old_n, new_n))
+            return p;
+
+        // Not the last allocation, or no room to extend it: copy it out
+        T *moved =
+            reinterpret_cast<T *>(alloc_bytes(sizeof(T) * new_n, alignment));
+        if (!moved)
+            return nullptr;
+        std::memcpy(moved, p, sizeof(T) * old_n);
+        num_allocations--;
+        return moved;
+    }
+
+    /**
+     * @brief Allocates and constructs an object of type T.
+     *
+     * @tparam T The type of object to construct.
+     * @param args Arguments forwarded to the constructor of T.
+     * @returns A pointer to the new object, or nullptr if allocation fails.
+     *
+     * If T is not trivially destructible, a destructor entry is stored in the
+     * arena next to it and the destructor runs when the memory is reclaimed by
+     * force_dealloc(), rewind() or the allocator's destructor. Trivially
+     * destructible types cost the same as alloc<T>(1). Either way the object
+     * counts as a single allocation, in get_num_allocations() and in the
+     * statistics, whose requested bytes include the entry.
+     */
+    template <class T, class... Args> T *make(Args &&...args) {
+        Checkpoint before = mark();
+        DestructorList::Entry *entry = nullptr;
+
+        T *object = alloc_object<T>(1, entry);
+        if (!object)
+            return nullptr;
+
+        // Give the memory back if the constructor throws
+        try {
+            new (object) T(std::forward<Args>(args)...);
+        } catch (...) {
+            rewind(before);
+            throw;
+        }
+
+        register_destructor(entry, object, 1);
+        return object;
+    }
+
+    /**
+     * @brief Allocates and constructs an array of n objects of type T.
+     *
+     * @tparam T The type of objects to construct.
+     * @param n Number of objects to construct.
+     * @param args Arguments passed to the constructor of every element.
+     * @returns A pointer to the first object, or nullptr if allocation fails.
+     *
+     * Destructors are handled as in make(), with one entry for the whole
+     * array.
+     */
+    template <class T, class... Args>
+    T *make_array(size_t n, const Args &...args) {
+        Checkpoint before = mark();
+        DestructorList::Entry *entry = nullptr;
+
+        T *objects = alloc_object<T>(n, entry);
+        if (!objects)
+            return nullptr;
+
+        // Destroy what was built and give the memory back if one throws
+        size_t built = 0;
+        try {
+            for (; built < n; built++)
+                new (objects + built) T(args...);
+        } catch (...) {
+            DestructorList::destroy<T>(objects, built);
+            rewind(before);
+            throw;
+        }
+
+        register_destructor(entry, objects, n);
+        return objects;
     }
 
     /**
@@ -81,6 +352,42 @@ template <size_t S> class BumpUp {
      */
     int get_num_allocations() { return num_allocations; }
 
+    /**
+     * @brief Gets the number of times force_dealloc() has emptied the
+     * allocator, so code holding on to its memory can tell it was reset.
+     * @return The number of resets since construction.
+     */
+    unsigned get_num_resets() { return num_resets; }
+
+    /**
+     * @brief Gets the size of the allocator's buffer.
+     * @return The capacity in bytes.
+     */
+    size_t capacity() { return S; }
+
+    /**
+     * @brief Checks whether a pointer lies in the allocator's buffer.
+     * @param p The pointer to check.
+     * @return true if p points into the buffer.
+     */
+    bool owns(const void *p) {
+        const byte *b = static_cast<const byte *>(p);
+        return b >= start && b < end;
+    }
+
+    /**
+     * @brief Gets the number of bytes in use, including alignment padding.
+     * @return The used bytes.
+     */
+    size_t used() { return ptr - start; }
+
+    /**
+     * @brief Gets the first byte in use, which is the start of the buffer.
+     * The bytes in use are [data(), data() + used()).
+     * @return The start of the used memory.
+     */
+    byte *data() { return start; }
+
     /**
      * @brief Deallocates memory for objects of type T.
      * If the number of allocations becomes zero, forces deallocation of all
@@ -91,23 +398,87 @@ template <size_t S> class BumpUp {
             force_dealloc();
     }
 
+    /**
+     * @brief Saves the current position of the bump pointer.
+     * @return A checkpoint to pass to rewind().
+     */
+    Checkpoint mark() { return {ptr, num_allocations, destructors.top()}; }
+
+    /**
+     * @brief Frees everything allocated since a checkpoint was taken.
+     * @param checkpoint A checkpoint from mark() that has not been rewound
+     * past already.
+     *
+     * Restores both the bump pointer and the allocation counter, so
+     * checkpoints can be nested and rewound innermost first. Objects made
+     * with make() since the checkpoint are destroyed, newest first.
+     */
+    void rewind(Checkpoint checkpoint) {
+        destructors.run_until(checkpoint.destructors);
+        ptr = checkpoint.ptr;
+        num_allocations = checkpoint.num_allocations;
+    }
+
     /**
      * @brief Forces deallocation of all memory.
+     * Destroys every object made with make(), newest first, and lets the
+     * storage policy see how much memory was used, so Trimming can give
+     * pages back.
      */
     void force_dealloc() {
+        destructors.run_until(nullptr);
+        notify_reset(storage, ptr - start, false);
         ptr = start;
         num_allocations = 0;
+        num_resets++;
     }
 
     /**
      * @brief Destructor for the BumpUp class.
-     * Deallocates the memory buffer.
+     * Destroys every object made with make().
      */
-    ~BumpUp() { delete[] start; }
+    ~BumpUp() { destructors.run_until(nullptr); }
 
   private:
-    byte *start;         ///< Start of the allocated memory buffer.
-    byte *ptr;           ///< Current bump pointer position.
-    byte *end;           ///< End of the allocated memory buffer.
-    int num_allocations; ///< Number of active allocations.
+    /**
+     * @brief Allocates room for n objects of type T, plus a destructor entry
+     * when T needs one.
+     */
+    template <class T>
+    T *alloc_object(size_t n, DestructorList::Entry *&entry) {
+        if constexpr (!std::is_trivially_destructible_v<T>) {
+            // One block, the entry and then the objects, so the statistics
+            // see the single allocation that make() counts
+            using Entry = DestructorList::Entry;
+            constexpr size_t alignment =
+                alignof(T) > alignof(Entry) ? alignof(T) : alignof(Entry);
+            constexpr size_t offset =
+                (sizeof(Entry) + alignof(T) - 1) & -alignof(T);
+            byte *block = alloc_bytes(offset + sizeof(T) * n, alignment);
+            if (!block)
+                return nullptr;
+            entry = reinterpret_cast<Entry *>(block);
+            return reinterpret_cast<T *>(block + offset);
+        } else {
+            return alloc<T>(n);
+        }
+    }
+
+    /**
+     * @brief Pushes the destructor entry made by alloc_object, if any.
+     */
+    template <class T>
+    void register_destructor(DestructorList::Entry *entry, T *objects,
+                             size_t n) {
+        if constexpr (!std::is_trivially_destructible_v<T>)
+            destructors.push(entry, objects, n);
+    }
+
+    Storage storage;            ///< Owner of the allocated memory buffer.
+    byte *start;                ///< Start of the allocated memory buffer.
+    byte *ptr;                  ///< Current bump pointer position.
+    byte *end;                  ///< End of the allocated memory buffer.
+    int num_allocations;        ///< Number of active allocations.
+    unsigned num_resets;        ///< Number of calls to force_dealloc().
+    DestructorList destructors; ///< Objects to destroy on reclaim.
 };
@@ -0,0 +1,89 @@
+#pragma once
+
+/**
+ * @file batch.hpp
+ * @brief Defines BatchLayout, which lays out a group of arrays of different
+ * types in one allocation.
+ */
+
+#include <array>   // For std::array
+#include <cstddef> // For size_t
+#include <tuple>   // For std::tuple
+#include <utility> // For std::index_sequence
+
+using std::byte;
+
+/**
+ * @brief Lays out one array of each of Ts in a single block of memory.
+ * @tparam Ts The element types, in the order the pointers are returned.
+ *
+ * The arrays are placed from the most to the least aligned type, whatever
+ * order Ts are listed in. Every array's size is a multiple of its alignment,
+ * which is at least the alignment of the arrays after it, so no padding is
+ * ever needed between them. The only alignment left is that of the block
+ * itself, which is the largest of Ts. The order is worked out at compile
+ * time, so placing the arrays only adds up their sizes.
+ */
+template <class... Ts> struct BatchLayout {
+    static_assert(sizeof...(Ts) > 0, "a batch needs at least one type");
+
+    /// Number of arrays in the batch.
+    static constexpr size_t count = sizeof...(Ts);
+
+    /// Indexes into Ts, most aligned first. Equal alignments keep their order.
+    static constexpr std::array<size_t, count> order = [] {
+        constexpr size_t alignments[] = {alignof(Ts)...};
+        std::array<size_t, count> sorted{};
+        for (size_t i = 0; i < count; i++) {
+            size_t j = i;
+            while (j > 0 && alignments[sorted[j - 1]] < alignments[i]) {
+                sorted[j] = sorted[j - 1];
+                j--;
+            }
+            sorted[j] = i;
+        }
+        return sorted;
+    }();
+
+    /// Alignment of the whole block, the largest alignment of Ts.
+    static constexpr size_t alignment = [] {
+        constexpr size_t alignments[] = {alignof(Ts)...};
+        return alignments[order[0]];
+    }();
+
+    /**
+     * @brief Computes where every array starts within the block.
+     * @param sizes Size in bytes of each array, in the order of Ts.
+     * @param offsets Receives the offset of each array, in the order of Ts.
+     * @return The size of the whole block.
+     */
+    static size_t place(const size_t (&sizes)[count],
+                        size_t (&offsets)[count]) {
+        size_t total = 0;
+        for (size_t k = 0; k < count; k++) {
+            offsets[order[k]] = total;
+            total += sizes[order[k]];
+        }
+        return total;
+    }
+
+    /**
+     * @brief Gets typed pointers to the arrays of a placed block.
+     * @param base The block, or nullptr to get a tuple of nullptrs.
+     * @param offsets The offsets from place().
+     */
+    static std::tuple<Ts *...> pointers(byte *base,
+                                        const size_t (&offsets)[count]) {
+        if (!base)
+            return {};
+        return pointers(base, offsets, std::index_sequence_for<Ts...>());
+    }
+
+  private:
+    template <size_t... I>
+    static std::tuple<Ts *...> pointers(byte *base,
+                                        const size_t (&offsets)[count],
+                                        std::index_sequence<I...>) {
+        return {reinterpret_cast<Ts *>(base + offsets[I])...};
+    }
+};
@@ -0,0 +1,158 @@
+#pragma once
+
+/**
+ * @file c_balloc.hpp
+ * @brief Defines the ConcurrentBumpUp class, a lock-free bump-pointer
+ * allocator that can be shared between threads.
+ */
+
+#include <atomic>  // For std::atomic
+#include <cstddef> // For size_t
+#include <cstdint> // For uintptr_t
+
+using std::byte;
+
+/**
+ * @class ConcurrentBumpUp
+ * @brief A bump-pointer allocator that many threads can allocate from at the
+ * same time without a lock.
+ * @tparam S The size of the memory buffer to be allocated.
+ *
+ * Space is claimed with a compare-and-swap on the bump pointer, so the
+ * alignment padding is recomputed from the pointer that was actually observed
+ * on every attempt. The allocation counter is split into cache-line sized
+ * shards, one per thread slot, so counting never bounces a shared line.
+ */
+template <size_t S> class ConcurrentBumpUp {
+  public:
+    /**
+     * @brief Constructor for the ConcurrentBumpUp class.
+     * Initializes the memory buffer and the bump pointer.
+     */
+    ConcurrentBumpUp() {
+        start = new byte[S];
+        end = start + S;
+        ptr.store(start, std::memory_order_relaxed);
+    }
+
+    ConcurrentBumpUp(const ConcurrentBumpUp &) = delete;
+    ConcurrentBumpUp &operator=(const ConcurrentBumpUp &) = delete;
+
+    /**
+     * @brief Allocates memory for an array of elements of type T.
+     *
+     * @tparam T The type of elements to allocate.
+     * @param n Number of elements to allocate space for.
+     * @returns A pointer to the allocated memory, or nullptr if allocation
+     * fails.
+     *
+     * Safe to call from any number of threads. If another thread moves the
+     * bump pointer between the load and the swap, the aligned position is
+     * recomputed from the new value and the claim is retried.
+     */
+    template <class T> T *alloc(size_t n) {
+        // Calculate the size needed for the allocation
+        size_t size = sizeof(T) * n;
+
+        // Calculate the alignment value for type T
+        size_t alignment = alignof(T);
+
+        byte *cur = ptr.load(std::memory_order_relaxed);
+        byte *aligned;
+        byte *new_ptr;
+        do {
+            // Calculate the aligned memory location from the observed pointer
+            aligned = reinterpret_cast<byte *>(
+                (reinterpret_cast<uintptr_t>(cur) - 1u + alignment) &
+                -alignment);
+
+            // Calculate the new pointer after the allocation
+            new_ptr = aligned + size;
+
+            // Check if the allocation exceeds the available memory
+            if (new_ptr > end) {
+                return nullptr;
+            }
+
+            // Publish the claim, on failure cur is reloaded and we retry
+        } while (!ptr.compare_exchange_weak(cur, new_ptr,
+                                            std::memory_order_relaxed,
+                                            std::memory_order_relaxed));
+
+        // Increment this thread's shard of the allocation counter
+        local_shard().count.fetch_add(1, std::memory_order_relaxed);
+
+        // Return the aligned pointer to the allocated memory
+        return reinterpret_cast<T *>(aligned);
+    }
+
+    /**
+     * @brief Gets the total number of allocations made using this allocator.
+     * @return The number of allocations, summed over all shards.
+     *
+     * @note The value is only exact when no other thread is allocating or
+     * deallocating at the same time.
+     */
+    int get_num_allocations() {
+        int total = 0;
+        for (Shard &shard : shards)
+            total += shard.count.load(std::memory_order_relaxed);
+        return total;
+    }
+
+    /**
+     * @brief Releases one allocation from the counter.
+     *
+     * Unlike BumpUp::dealloc this never resets the buffer by itself, because
+     * another thread may be allocating while the count passes through zero.
+     * Call force_dealloc() once all threads are done with the arena.
+     */
+    void dealloc() {
+        local_shard().count.fetch_sub(1, std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief Forces deallocation of all memory.
+     *
+     * @note Must not run concurrently with alloc() or dealloc().
+     */
+    void force_dealloc() {
+        ptr.store(start, std::memory_order_relaxed);
+        for (Shard &shard : shards)
+            shard.count.store(0, std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief Destructor for the ConcurrentBumpUp class.
+     * Deallocates the memory buffer.
+     */
+    ~ConcurrentBumpUp() { delete[] start; }
+
+  private:
+    static constexpr size_t NUM_SHARDS = 16; ///< Number of counter shards.
+
+    /**
+     * @brief One cache line holding part of the allocation counter.
+     */
+    struct alignas(64) Shard {
+        std::atomic<int> count{0}; ///< Allocations counted by this shard.
+    };
+
+    /**
+     * @brief Gets the counter shard assigned to the calling thread.
+     *
+     * Threads are handed shard slots round robin the first time they count
+     * anything, so up to NUM_SHARDS threads never share a line.
+     */
+    Shard &local_shard() {
+        static std::atomic<size_t> next_slot{0};
+        thread_local const size_t slot =
+            next_slot.fetch_add(1, std::memory_order_relaxed) % NUM_SHARDS;
+        return shards[slot];
+    }
+
+    byte *start;              ///< Start of the allocated memory buffer.
+    std::atomic<byte *> ptr;  ///< Current bump pointer position.
+    byte *end;                ///< End of the allocated memory buffer.
+    Shard shards[NUM_SHARDS]; ///< Sharded number of active allocations.
+};
@@ -0,0 +1,244 @@
+#pragma once
+
+/**
+ * @file chain_balloc.hpp
+ * @brief Defines the BumpChain class, a bump-pointer allocator that grows by
+ * linking in new chunks instead of failing when its buffer is exhausted.
+ */
+
+#include <cstddef> // For size_t
+#include <cstdint> // For uintptr_t
+
+using std::byte;
+
+/**
+ * @brief Growth policy that multiplies the chunk size on every new chunk.
+ * @tparam Factor The multiplier applied to the previous chunk size.
+ * @tparam Max The largest chunk size the policy will ever ask for.
+ */
+template <size_t Factor = 2, size_t Max = (size_t)64 << 20>
+struct GeometricGrowth {
+    static constexpr size_t next(size_t prev) {
+        if (prev >= Max)
+            return prev;
+        return prev * Factor < Max ? prev * Factor : Max;
+    }
+};
+
+/**
+ * @brief Growth policy that makes every chunk the same size as the first.
+ */
+struct FixedGrowth {
+    static constexpr size_t next(size_t prev) { return prev; }
+};
+
+/**
+ * @class BumpChain
+ * @brief A bump-pointer allocator made of a chain of chunks.
+ * @tparam S The size of the first chunk.
+ * @tparam Growth Policy giving the size of the next chunk from the previous
+ * one, see GeometricGrowth and FixedGrowth.
+ *
+ * Allocation has the same fast path as BumpUp. When the current chunk is full
+ * the next chunk in the chain is used, and a new one is only requested from
+ * the system when the chain runs out. Requests that would not fit in the next
+ * chunk get a dedicated chunk of their own so they do not waste the
+ * remainder of a regular one.
+ */
+template <size_t S, class Growth = GeometricGrowth<>> class BumpChain {
+  public:
+    /**
+     * @brief Constructor for the BumpChain class.
+     * Allocates the first chunk and sets the bump pointer to its start.
+     */
+    BumpChain() {
+        first = new_chunk(S);
+        current = first;
+        ptr = first->data();
+        end = first->end;
+        oversized = nullptr;
+        num_allocations = 0;
+        num_chunks = 1;
+    }
+
+    BumpChain(const BumpChain &) = delete;
+    BumpChain &operator=(const BumpChain &) = delete;
+
+    /**
+     * @brief Allocates memory for an array of elements of type T.
+     *
+     * @tparam T The type of elements to allocate.
+     * @param n Number of elements to allocate space for.
+     * @returns A pointer to the allocated memory.
+     *
+     * Identical to BumpUp::alloc while the current chunk has room, otherwise
+     * moves on to the next chunk. Throws std::bad_alloc if the system is out
+     * of memory.
+     */
+    template <class T> T *alloc(size_t n) {
+        return reinterpret_cast<T *>(alloc_bytes(sizeof(T) * n, alignof(T)));
+    }
+
+    /**
+     * @brief Allocates raw memory with the given size and alignment.
+     *
+     * @param size Number of bytes to allocate.
+     * @param alignment Alignment of the returned pointer, must be a power of
+     * two.
+     * @returns A pointer to the allocated memory.
+     */
+    byte *alloc_bytes(size_t size, size_t alignment) {
+        // Calculate the aligned memory location
+        byte *aligned = reinterpret_cast<byte *>(
+            (reinterpret_cast<uintptr_t>(ptr) - 1u + alignment) & -alignment);
+
+        // Calculate the new pointer after the allocation
+        byte *new_ptr = aligned + size;
+
+        // Fall back to the next chunk if this one is exhausted
+        if (new_ptr > end) {
+            return alloc_slow(size, alignment);
+        }
+
+        // Update the current pointer to the new position
+        ptr = new_ptr;
+
+        // Increment the global allocation counter
+        num_allocations++;
+
+        // Return the aligned pointer to the allocated memory
+        return aligned;
+    }
+
+    /**
+     * @brief Gets the total number of allocations made using this allocator.
+     * @return The number of allocations.
+     */
+    int get_num_allocations() { return num_allocations; }
+
+    /**
+     * @brief Gets the number of chunks currently held from the system.
+     * @return The number of regular and dedicated chunks.
+     */
+    int get_num_chunks() { return num_chunks; }
+
+    /**
+     * @brief Deallocates memory for objects of type T.
+     * If the number of allocations becomes zero, forces deallocation of all
+     * memory.
+     */
+    void dealloc() {
+        if (--num_allocations == 0)
+            force_dealloc();
+    }
+
+    /**
+     * @brief Forces deallocation of all memory.
+     *
+     * Rewinds to the first chunk but keeps the regular chunks cached, so a
+     * loop that needs the same amount of memory every round stops calling the
+     * system allocator after the first one. Dedicated chunks are returned.
+     */
+    void force_dealloc() {
+        release(oversized);
+        oversized = nullptr;
+        current = first;
+        ptr = first->data();
+        end = first->end;
+        num_allocations = 0;
+    }
+
+    /**
+     * @brief Destructor for the BumpChain class.
+     * Deallocates every chunk.
+     */
+    ~BumpChain() {
+        release(oversized);
+        release(first);
+    }
+
+  private:
+    /**
+     * @brief Header placed at the start of every chunk.
+     */
+    struct Chunk {
+        Chunk *next; ///< Next chunk in the chain.
+        byte *end;   ///< End of this chunk's memory.
+
+        /**
+         * @brief Gets the first usable byte after the header.
+         */
+        byte *data() { return reinterpret_cast<byte *>(this + 1); }
+    };
+
+    /**
+     * @brief Gets a chunk with room for size bytes from the system.
+     */
+    Chunk *new_chunk(size_t size) {
+        byte *memory = new byte[sizeof(Chunk) + size];
+        Chunk *chunk = reinterpret_cast<Chunk *>(memory);
+        chunk->next = nullptr;
+        chunk->end = chunk->data() + size;
+        return chunk;
+    }
+
+    /**
+     * @brief Returns a list of chunks to the system.
+     */
+    void release(Chunk *chunk) {
+        while (chunk) {
+            Chunk *next = chunk->next;
+            delete[] reinterpret_cast<byte *>(chunk);
+            chunk = next;
+            num_chunks--;
+        }
+    }
+
+    /**
+     * @brief Aligns a pointer up to the given alignment.
+     */
+    static byte *align(byte *p, size_t alignment) {
+        return reinterpret_cast<byte *>(
+            (reinterpret_cast<uintptr_t>(p) - 1u + alignment) & -alignment);
+    }
+
+    /**
+     * @brief Serves an allocation that did not fit in the current chunk.
+     */
+    byte *alloc_slow(size_t size, size_t alignment) {
+        size_t needed = size + alignment - 1;
+        size_t current_size = current->end - current->data();
+        size_t next_size = Growth::next(current_size);
+
+        // Too big for a regular chunk, give it one of its own
+        if (needed > next_size) {
+            Chunk *chunk = new_chunk(needed);
+            chunk->next = oversized;
+            oversized = chunk;
+            num_chunks++;
+            num_allocations++;
+            return align(chunk->data(), alignment);
+        }
+
+        // Reuse a cached chunk if there is one, otherwise grow the chain
+        if (!current->next) {
+            current->next = new_chunk(next_size);
+            num_chunks++;
+        }
+        current = current->next;
+
+        byte *aligned = align(current->data(), alignment);
+        ptr = aligned + size;
+        end = current->end;
+        num_allocations++;
+        return aligned;
+    }
+
+    Chunk *first;        ///< First chunk of the chain.
+    Chunk *current;      ///< Chunk the bump pointer is in.
+    Chunk *oversized;    ///< Dedicated chunks for oversized requests.
+    byte *ptr;           ///< Current bump pointer position.
+    byte *end;           ///< End of the current chunk.
+    int num_allocations; ///< Number of active allocations.
+    int num_chunks;      ///< Number of chunks held from the system.
+};
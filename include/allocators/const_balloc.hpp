@@ -0,0 +1,192 @@
+#pragma once
+
+/**
+ * @file const_balloc.hpp
+ * @brief Defines ConstArena and StaticArena, allocators whose work is done at
+ * compile time.
+ */
+
+#include <array>   // For std::array
+#include <cstddef> // For size_t
+#include <tuple>   // For std::tuple_element_t
+
+using std::byte;
+
+/**
+ * @class ConstArena
+ * @brief A bump allocator for elements of one type that works in constant
+ * expressions.
+ * @tparam T The element type, which must be default constructible and a
+ * literal type.
+ * @tparam N The number of elements the arena holds.
+ *
+ * The storage is an array of T rather than raw bytes, since constant
+ * evaluation cannot reinterpret memory. That makes it usable inside constexpr
+ * functions, for example to build lookup tables from intermediate arrays.
+ * Running out of space returns nullptr as usual, and using that pointer in a
+ * constant expression is a compile error.
+ *
+ * ```cpp
+ * constexpr int sum_of_squares() {
+ *     ConstArena<int, 16> arena;
+ *     int *squares = arena.alloc(10);
+ *     // ...
+ * }
+ * static_assert(sum_of_squares() == 285);
+ * ```
+ */
+template <class T, size_t N> class ConstArena {
+  public:
+    /**
+     * @brief Constructor for the ConstArena class.
+     */
+    constexpr ConstArena() : storage{}, used(0), num_allocations(0) {}
+
+    /**
+     * @brief Allocates n elements.
+     * @param n Number of elements to allocate.
+     * @returns A pointer to the first element, or nullptr if they do not fit.
+     */
+    constexpr T *alloc(size_t n) {
+        if (n > N - used)
+            return nullptr;
+        T *p = storage + used;
+        used += n;
+        num_allocations++;
+        return p;
+    }
+
+    /**
+     * @brief Gets the number of allocations made using this allocator.
+     * @return The number of allocations.
+     */
+    constexpr int get_num_allocations() const { return num_allocations; }
+
+    /**
+     * @brief Gets the number of elements in use.
+     */
+    constexpr size_t size() const { return used; }
+
+    /**
+     * @brief Gets the number of elements the arena holds.
+     */
+    static constexpr size_t capacity() { return N; }
+
+    /**
+     * @brief Deallocates one allocation. If none are left, forces
+     * deallocation of all memory.
+     */
+    constexpr void dealloc() {
+        if (--num_allocations == 0)
+            force_dealloc();
+    }
+
+    /**
+     * @brief Forces deallocation of all memory.
+     */
+    constexpr void force_dealloc() {
+        used = 0;
+        num_allocations = 0;
+    }
+
+  private:
+    T storage[N];        ///< The elements handed out.
+    size_t used;         ///< Number of elements in use.
+    int num_allocations; ///< Number of active allocations.
+};
+
+/**
+ * @brief One planned allocation of a StaticArena: N elements of type T.
+ */
+template <class T, size_t N = 1> struct ArenaSlot {
+    using type = T;                    ///< Element type.
+    static constexpr size_t count = N; ///< Number of elements.
+};
+
+/**
+ * @class StaticArena
+ * @brief An arena whose allocations are all planned at compile time.
+ * @tparam S The size of the arena's buffer.
+ * @tparam Slots The planned allocations, as ArenaSlot<T, N>, in order.
+ *
+ * The slots are laid out the way BumpUp would place them one after another,
+ * but the alignment and offsets are computed by the compiler. A plan that
+ * does not fit in S fails a static_assert instead of returning nullptr at
+ * runtime. The buffer is stored inline, so get<I>() is the arena's own
+ * address plus a constant, with no arithmetic or bounds check left.
+ *
+ * Like alloc(), slots hold uninitialized memory.
+ *
+ * ```cpp
+ * StaticArena<256, ArenaSlot<Header>, ArenaSlot<uint16_t, 8>> message;
+ * Header *header = message.get<0>();
+ * uint16_t *fields = message.get<1>();
+ * ```
+ */
+template <size_t S, class... Slots> class StaticArena {
+    static_assert(sizeof...(Slots) > 0, "the plan needs at least one slot");
+
+  public:
+    /// Number of planned allocations.
+    static constexpr size_t count = sizeof...(Slots);
+
+    /**
+     * @brief Gets the memory of the I-th planned allocation.
+     * @tparam I Index of the slot in Slots.
+     */
+    template <size_t I> auto *get() {
+        using T = typename std::tuple_element_t<I, std::tuple<Slots...>>::type;
+        return reinterpret_cast<T *>(buffer + offsets[I]);
+    }
+
+    /**
+     * @brief Gets the offset of the I-th planned allocation in the buffer.
+     */
+    template <size_t I> static constexpr size_t offset() { return offsets[I]; }
+
+    /**
+     * @brief Gets the number of bytes the plan uses, padding included.
+     */
+    static constexpr size_t used() { return end; }
+
+    /**
+     * @brief Gets the size of the arena's buffer.
+     */
+    static constexpr size_t capacity() { return S; }
+
+  private:
+    /// Alignment of the buffer, the largest alignment in the plan.
+    static constexpr size_t alignment = [] {
+        constexpr size_t alignments[] = {alignof(typename Slots::type)...};
+        size_t largest = 1;
+        for (size_t a : alignments)
+            largest = a > largest ? a : largest;
+        return largest;
+    }();
+
+    /// Offset of every slot, aligned like successive BumpUp allocations.
+    static constexpr std::array<size_t, count> offsets = [] {
+        constexpr size_t sizes[] = {sizeof(typename Slots::type) *
+                                    Slots::count...};
+        constexpr size_t alignments[] = {alignof(typename Slots::type)...};
+        std::array<size_t, count> placed{};
+        size_t ptr = 0;
+        for (size_t i = 0; i < count; i++) {
+            ptr = (ptr - 1u + alignments[i]) & -alignments[i];
+            placed[i] = ptr;
+            ptr += sizes[i];
+        }
+        return placed;
+    }();
+
+    /// End of the last slot.
+    static constexpr size_t end = [] {
+        constexpr size_t sizes[] = {sizeof(typename Slots::type) *
+                                    Slots::count...};
+        return offsets[count - 1] + sizes[count - 1];
+    }();
+
+    static_assert(end <= S, "the planned allocations do not fit in S");
+
+    alignas(alignment) byte buffer[S]; ///< The planned allocations.
+};
@@ -0,0 +1,211 @@
+#pragma once
+
+/**
+ * @file de_balloc.hpp
+ * @brief Defines the DoubleEndedBump class, which bump allocates from both
+ * ends of one buffer.
+ */
+
+#include <cstddef> // For size_t
+#include <cstdint> // For uintptr_t
+
+#include "storage.hpp" // For HeapStorage
+
+using std::byte;
+
+/**
+ * @class DoubleEndedBump
+ * @brief A bump-pointer allocator that grows up from the bottom of its buffer
+ * and down from the top.
+ * @tparam S The size of the memory buffer to be allocated.
+ * @tparam Storage Policy providing the buffer, such as HeapStorage or
+ * MmapStorage. With Trimming, resetting an end can give back the pages it
+ * no longer needs, but never those the other end is using.
+ *
+ * The low end works like BumpUp and the high end like BumpDown, and the two
+ * share the free space in the middle. A typical split keeps results that
+ * outlive a phase at the bottom and scratch memory at the top, which is reset
+ * on its own after each step. Either end can use the whole buffer while the
+ * other is empty, so one buffer replaces two that would each need the peak
+ * size.
+ *
+ * Each allocation checks against the other end's pointer only, since that is
+ * the one limit it can run into.
+ *
+ * ```cpp
+ * DoubleEndedBump<1 << 20> arena;
+ * int *result = arena.alloc_up<int>(n);
+ * float *scratch = arena.alloc_down<float>(m);
+ * arena.reset_down(); // result is kept
+ * ```
+ */
+template <size_t S, class Storage = HeapStorage> class DoubleEndedBump {
+  public:
+    /**
+     * @brief Constructor for the DoubleEndedBump class.
+     * Initializes the memory buffer and both bump pointers.
+     */
+    DoubleEndedBump() : storage(S) {
+        start = storage.data();
+        end = start + S;
+        up_ptr = start;
+        down_ptr = end;
+        num_up_allocations = 0;
+        num_down_allocations = 0;
+    }
+
+    /**
+     * @brief Allocates memory for n elements of type T from the bottom.
+     *
+     * @tparam T The type of elements to allocate.
+     * @param n Number of elements to allocate space for.
+     * @returns A pointer to the allocated memory, or nullptr if it would run
+     * into the top end.
+     */
+    template <class T> T *alloc_up(size_t n) {
+        return reinterpret_cast<T *>(
+            alloc_bytes_up(sizeof(T) * n, alignof(T)));
+    }
+
+    /**
+     * @brief Allocates memory for n elements of type T from the top.
+     *
+     * @tparam T The type of elements to allocate.
+     * @param n Number of elements to allocate space for.
+     * @returns A pointer to the allocated memory, or nullptr if it would run
+     * into the bottom end.
+     */
+    template <class T> T *alloc_down(size_t n) {
+        return reinterpret_cast<T *>(
+            alloc_bytes_down(sizeof(T) * n, alignof(T)));
+    }
+
+    /**
+     * @brief Allocates raw memory from the bottom.
+     *
+     * @param size Number of bytes to allocate.
+     * @param alignment Alignment of the returned pointer, must be a power of
+     * two.
+     * @returns A pointer to the allocated memory, or nullptr if allocation
+     * fails.
+     */
+    byte *alloc_bytes_up(size_t size, size_t alignment) {
+        // Calculate the aligned memory location
+        byte *aligned = reinterpret_cast<byte *>(
+            (reinterpret_cast<uintptr_t>(up_ptr) - 1u + alignment) &
+            -alignment);
+
+        // Calculate the new pointer after the allocation
+        byte *new_ptr = aligned + size;
+
+        // Check if the allocation runs into the top end
+        if (new_ptr > down_ptr) {
+            return nullptr;
+        }
+
+        // Update the bottom pointer and the allocation counter
+        up_ptr = new_ptr;
+        num_up_allocations++;
+        return aligned;
+    }
+
+    /**
+     * @brief Allocates raw memory from the top.
+     *
+     * @param size Number of bytes to allocate.
+     * @param alignment Alignment of the returned pointer, must be a power of
+     * two.
+     * @returns A pointer to the allocated memory, or nullptr if allocation
+     * fails.
+     */
+    byte *alloc_bytes_down(size_t size, size_t alignment) {
+        // Calculate the new, aligned pointer after the allocation
+        byte *new_ptr = reinterpret_cast<byte *>(
+            reinterpret_cast<uintptr_t>(down_ptr - size) & -alignment);
+
+        // Check if the allocation runs into the bottom end
+        if (new_ptr < up_ptr) {
+            return nullptr;
+        }
+
+        // Update the top pointer and the allocation counter
+        down_ptr = new_ptr;
+        num_down_allocations++;
+        return new_ptr;
+    }
+
+    /**
+     * @brief Gets the number of allocations made from either end.
+     * @return The number of allocations.
+     */
+    int get_num_allocations() {
+        return num_up_allocations + num_down_allocations;
+    }
+
+    /**
+     * @brief Gets the size of the allocator's buffer.
+     * @return The capacity in bytes.
+     */
+    size_t capacity() { return S; }
+
+    /**
+     * @brief Gets the number of bytes still free between the two ends.
+     * @return The free bytes.
+     */
+    size_t available() { return down_ptr - up_ptr; }
+
+    /**
+     * @brief Deallocates one allocation from the bottom.
+     * If the bottom has no allocations left, it is reset.
+     */
+    void dealloc_up() {
+        if (--num_up_allocations == 0)
+            reset_up();
+    }
+
+    /**
+     * @brief Deallocates one allocation from the top.
+     * If the top has no allocations left, it is reset.
+     */
+    void dealloc_down() {
+        if (--num_down_allocations == 0)
+            reset_down();
+    }
+
+    /**
+     * @brief Frees everything allocated from the bottom, and lets the storage
+     * policy see how much of it was used.
+     */
+    void reset_up() {
+        notify_reset(storage, up_ptr - start, false, end - down_ptr);
+        up_ptr = start;
+        num_up_allocations = 0;
+    }
+
+    /**
+     * @brief Frees everything allocated from the top, and lets the storage
+     * policy see how much of it was used.
+     */
+    void reset_down() {
+        notify_reset(storage, end - down_ptr, true, up_ptr - start);
+        down_ptr = end;
+        num_down_allocations = 0;
+    }
+
+    /**
+     * @brief Forces deallocation of all memory, at both ends.
+     */
+    void force_dealloc() {
+        reset_up();
+        reset_down();
+    }
+
+  private:
+    Storage storage;          ///< Owner of the allocated memory buffer.
+    byte *start;              ///< Start of the allocated memory buffer.
+    byte *end;                ///< End of the allocated memory buffer.
+    byte *up_ptr;             ///< End of the bottom allocations.
+    byte *down_ptr;           ///< Start of the top allocations.
+    int num_up_allocations;   ///< Number of allocations from the bottom.
+    int num_down_allocations; ///< Number of allocations from the top.
+};
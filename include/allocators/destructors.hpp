@@ -0,0 +1,71 @@
+#pragma once
+
+/**
+ * @file destructors.hpp
+ * @brief Defines the DestructorList class, which remembers the objects of an
+ * allocator that need their destructors run when memory is reclaimed.
+ */
+
+#include <cstddef> // For size_t
+
+/**
+ * @class DestructorList
+ * @brief An intrusive stack of destructor entries stored inside the arena.
+ *
+ * The allocators place an Entry next to every non-trivially destructible
+ * object they construct and push it here. Popping runs the destructors in the
+ * reverse order the objects were made.
+ */
+class DestructorList {
+  public:
+    /**
+     * @brief Record of one constructed object or array.
+     */
+    struct Entry {
+        void (*destroy)(void *, size_t); ///< Destroys count objects.
+        void *objects;                   ///< First object to destroy.
+        size_t count;                    ///< Number of objects.
+        Entry *prev;                     ///< Entry pushed before this one.
+    };
+
+    /**
+     * @brief Destroys an array of objects of type T, last element first.
+     */
+    template <class T> static void destroy(void *objects, size_t count) {
+        T *typed = static_cast<T *>(objects);
+        while (count > 0)
+            typed[--count].~T();
+    }
+
+    /**
+     * @brief Records an entry for count objects of type T.
+     * @param entry Arena memory to hold the record.
+     */
+    template <class T> void push(Entry *entry, T *objects, size_t count) {
+        entry->destroy = &destroy<T>;
+        entry->objects = objects;
+        entry->count = count;
+        entry->prev = head;
+        head = entry;
+    }
+
+    /**
+     * @brief Gets the most recent entry, to be used as a stop for run_until().
+     */
+    Entry *top() { return head; }
+
+    /**
+     * @brief Runs destructors, newest first, until stop is the newest entry.
+     * @param stop An entry from top(), or nullptr to run every destructor.
+     */
+    void run_until(Entry *stop) {
+        while (head != stop) {
+            Entry *entry = head;
+            head = entry->prev;
+            entry->destroy(entry->objects, entry->count);
+        }
+    }
+
+  private:
+    Entry *head = nullptr; ///< Most recently pushed entry.
+};
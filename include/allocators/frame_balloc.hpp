@@ -0,0 +1,271 @@
+#pragma once
+
+/**
+ * @file frame_balloc.hpp
+ * @brief Defines the FrameRing class, a ring of arenas that are used one per
+ * request or frame, and the policies for cleaning them up on release.
+ */
+
+#include <atomic>             // For std::atomic
+#include <condition_variable> // For std::condition_variable
+#include <cstddef>            // For size_t
+#include <cstdint>            // For uintptr_t
+#include <cstring>            // For std::memset
+#include <mutex>              // For std::mutex
+#include <sys/mman.h>         // For madvise
+#include <thread>             // For std::thread
+#include <unistd.h>           // For sysconf
+#include <vector>             // For std::vector
+
+using std::byte;
+
+/**
+ * @brief Release policy that only resets the arena.
+ */
+struct FrameReset {
+    static void release(byte *, size_t) {}
+};
+
+/**
+ * @brief Release policy that zeroes the used memory, so nothing from one
+ * frame can leak into the next.
+ */
+struct FrameScrub {
+    static void release(byte *data, size_t size) {
+        std::memset(data, 0, size);
+    }
+};
+
+/**
+ * @brief Release policy that gives the used pages back to the kernel with
+ * MADV_DONTNEED. They read as zeros and are faulted in again when the arena
+ * is next used. Meant for arenas on MmapStorage.
+ *
+ * Only pages wholly inside the used range are discarded, since the rest of a
+ * partial page may belong to something else.
+ */
+struct FrameDiscard {
+    static void release(byte *data, size_t size) {
+        static const size_t page = sysconf(_SC_PAGESIZE);
+        uintptr_t first = (reinterpret_cast<uintptr_t>(data) - 1u + page) &
+                          -page;
+        uintptr_t last = (reinterpret_cast<uintptr_t>(data) + size) & -page;
+        if (first < last)
+            madvise(reinterpret_cast<void *>(first), last - first,
+                    MADV_DONTNEED);
+    }
+};
+
+/**
+ * @class FrameRing
+ * @brief A ring of K arenas, each used for one request or frame at a time.
+ * @tparam Arena The allocator of every frame, such as BumpUp or BumpDown.
+ * @tparam K The number of arenas in the ring.
+ * @tparam Release Policy applied to a frame's used memory before it is reset:
+ * FrameReset, FrameScrub or FrameDiscard.
+ *
+ * next() hands out the arenas in ring order. A frame stays valid until it is
+ * released, so pipelined stages can keep reading frame N while frame N+1 is
+ * being built in the next arena, without copying. Allocation goes straight to
+ * the arena and never takes a lock.
+ *
+ * release() can be called from any thread. It applies the Release policy and
+ * resets the arena, either right away or, when the ring is constructed with
+ * background set, on a worker thread, so a scrub or madvise of a large frame
+ * stays off the request path. next() only waits if the arena it comes back
+ * to has not been released and cleaned up yet, which means more than K
+ * frames are in flight.
+ *
+ * next() must be called from one thread at a time.
+ *
+ * ```cpp
+ * FrameRing<BumpUp<1 << 20, MmapStorage<>>, 3, FrameDiscard> frames(true);
+ * auto &frame = frames.next();
+ * Request *r = frame.alloc<Request>(1);
+ * // ... hand r to the next stage, which later calls:
+ * frames.release(frame);
+ * ```
+ */
+template <class Arena, size_t K, class Release = FrameReset> class FrameRing {
+    static_assert(K > 0, "the ring needs at least one arena");
+
+  public:
+    /**
+     * @brief Constructor for the FrameRing class.
+     * @param background Whether released frames are cleaned up on a worker
+     * thread instead of by the thread that releases them.
+     */
+    explicit FrameRing(bool background = false)
+        : head(0), num_frames(0), stopping(false) {
+        for (Frame &frame : frames)
+            frame.state.store(FREE, std::memory_order_relaxed);
+        if (background)
+            worker = std::thread([this] { run_worker(); });
+    }
+
+    FrameRing(const FrameRing &) = delete;
+    FrameRing &operator=(const FrameRing &) = delete;
+
+    /**
+     * @brief Takes the next arena of the ring for a new frame.
+     * @return The arena, empty. It is the caller's until release().
+     *
+     * Waits if that arena is still in use or being cleaned up.
+     */
+    Arena &next() {
+        Frame &frame = frames[head];
+        head = (head + 1) % K;
+
+        if (frame.state.load(std::memory_order_acquire) != FREE) {
+            std::unique_lock<std::mutex> lock(mutex);
+            freed.wait(lock, [&] {
+                return frame.state.load(std::memory_order_acquire) == FREE;
+            });
+        }
+
+        frame.state.store(IN_USE, std::memory_order_relaxed);
+        num_frames++;
+        return frame.arena;
+    }
+
+    /**
+     * @brief Ends a frame, from any thread.
+     * @param arena An arena returned by next().
+     *
+     * Everything allocated in the frame must no longer be used. An arena that
+     * is not from this ring, or is not in use, is ignored, so a frame
+     * released twice is only cleaned up once.
+     */
+    void release(Arena &arena) {
+        size_t i = index_of(arena);
+        if (i == K)
+            return;
+
+        Frame &frame = frames[i];
+        int expected = IN_USE;
+        if (!frame.state.compare_exchange_strong(expected, RELEASING,
+                                                 std::memory_order_relaxed))
+            return;
+
+        if (worker.joinable()) {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                pending.push_back(&frame);
+            }
+            work.notify_one();
+        } else {
+            clean(frame);
+        }
+    }
+
+    /**
+     * @brief Waits until every released frame has been cleaned up.
+     */
+    void drain() {
+        std::unique_lock<std::mutex> lock(mutex);
+        freed.wait(lock, [&] {
+            for (Frame &frame : frames)
+                if (frame.state.load(std::memory_order_acquire) == RELEASING)
+                    return false;
+            return true;
+        });
+    }
+
+    /**
+     * @brief Gets the number of frames started with next().
+     * @return The number of frames.
+     */
+    size_t get_num_frames() { return num_frames; }
+
+    /**
+     * @brief Gets the number of arenas in the ring.
+     */
+    static constexpr size_t size() { return K; }
+
+    /**
+     * @brief Destructor for the FrameRing class.
+     * Finishes the pending cleanups and stops the worker thread.
+     */
+    ~FrameRing() {
+        if (worker.joinable()) {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                stopping = true;
+            }
+            work.notify_one();
+            worker.join();
+        }
+    }
+
+  private:
+    /**
+     * @brief States of a frame.
+     */
+    enum State : int {
+        FREE,      ///< Empty, ready for next().
+        IN_USE,    ///< Handed out by next().
+        RELEASING, ///< Released, waiting to be cleaned up.
+    };
+
+    /**
+     * @brief An arena and its state.
+     */
+    struct Frame {
+        Arena arena;            ///< The frame's memory.
+        std::atomic<int> state; ///< One of State.
+    };
+
+    /**
+     * @brief Gets the position of an arena in the ring.
+     * @return The position, or K if the arena is not in the ring.
+     */
+    size_t index_of(Arena &arena) {
+        size_t i = 0;
+        while (i < K && &frames[i].arena != &arena)
+            i++;
+        return i;
+    }
+
+    /**
+     * @brief Applies the release policy, resets the arena and marks it free.
+     */
+    void clean(Frame &frame) {
+        Release::release(frame.arena.data(), frame.arena.used());
+        frame.arena.force_dealloc();
+        {
+            // Under the lock, so a thread about to wait cannot miss it
+            std::lock_guard<std::mutex> lock(mutex);
+            frame.state.store(FREE, std::memory_order_release);
+        }
+        freed.notify_all();
+    }
+
+    /**
+     * @brief Cleans up released frames until the ring is destroyed.
+     */
+    void run_worker() {
+        std::unique_lock<std::mutex> lock(mutex);
+        while (true) {
+            work.wait(lock, [&] { return stopping || !pending.empty(); });
+            if (pending.empty())
+                return;
+
+            std::vector<Frame *> batch;
+            batch.swap(pending);
+            lock.unlock();
+            for (Frame *frame : batch)
+                clean(*frame);
+            lock.lock();
+        }
+    }
+
+    Frame frames[K];               ///< The ring of arenas.
+    size_t head;                   ///< Next frame handed out by next().
+    size_t num_frames;             ///< Frames started so far.
+    std::mutex mutex;              ///< Guards pending, stopping and waiting.
+    std::condition_variable freed; ///< Signalled when a frame is cleaned.
+    std::condition_variable work;  ///< Signalled when a frame is released.
+    std::vector<Frame *> pending;  ///< Frames waiting for the worker.
+    bool stopping;                 ///< Set to stop the worker.
+    std::thread worker;            ///< Cleans up frames, if background.
+};
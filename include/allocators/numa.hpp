@@ -0,0 +1,261 @@
+#pragma once
+
+/**
+ * @file numa.hpp
+ * @brief Defines NumaStorage, a storage policy that places the buffer on a
+ * NUMA node, and NumaArenas, which keeps one arena per node. Linux only.
+ *
+ * Everything goes through raw system calls, so there is no dependency on
+ * libnuma. On a machine with a single node, or a kernel without NUMA support,
+ * nothing is bound and every arena behaves like one on plain MmapStorage.
+ */
+
+#include <cstddef>       // For size_t
+#include <cstdint>       // For uintptr_t
+#include <fstream>       // For std::ifstream
+#include <memory>        // For std::unique_ptr
+#include <sys/syscall.h> // For SYS_getcpu, SYS_mbind and SYS_get_mempolicy
+#include <unistd.h>      // For syscall
+#include <vector>        // For std::vector
+
+#include "storage.hpp" // For MmapStorage
+
+using std::byte;
+
+/// Highest number of nodes a node mask can describe.
+constexpr int numa_max_nodes = 1024;
+
+/**
+ * @brief Gets the number of NUMA nodes, which is one more than the highest
+ * node number.
+ * @return The number of nodes, 1 if the system does not say.
+ */
+inline int numa_node_count() {
+    static const int count = [] {
+        // The file lists ranges such as "0-1" or "0,2-3"
+        std::ifstream online("/sys/devices/system/node/online");
+        int highest = 0;
+        int value = 0;
+        char c;
+        while (online.get(c)) {
+            if (c >= '0' && c <= '9') {
+                value = value * 10 + (c - '0');
+            } else {
+                highest = value > highest ? value : highest;
+                value = 0;
+            }
+        }
+        highest = value > highest ? value : highest;
+        return highest < numa_max_nodes ? highest + 1 : numa_max_nodes;
+    }();
+    return count;
+}
+
+/**
+ * @brief Gets the node of the CPU the calling thread is running on. The
+ * thread may be moved to another node right after.
+ * @return The node, 0 if it cannot be found.
+ */
+inline int numa_current_node() {
+#ifdef SYS_getcpu
+    unsigned cpu, node;
+    if (syscall(SYS_getcpu, &cpu, &node, nullptr) == 0)
+        return node;
+#endif
+    return 0;
+}
+
+/**
+ * @brief Gets the node a page of memory is on, faulting it in if needed.
+ * @param p Any address inside the page.
+ * @return The node, or -1 if it cannot be found.
+ */
+inline int numa_node_of(const void *p) {
+#ifdef SYS_get_mempolicy
+    constexpr unsigned long flags = 3; // MPOL_F_NODE | MPOL_F_ADDR
+    int node;
+    if (syscall(SYS_get_mempolicy, &node, nullptr, 0, p, flags) == 0)
+        return node;
+#endif
+    return -1;
+}
+
+/**
+ * @brief Memory policies of NumaStorage, the values of the kernel's MPOL_*.
+ */
+enum NumaPolicy : int {
+    NUMA_PREFERRED = 1, ///< Use the node while it has free memory.
+    NUMA_BIND = 2,      ///< Only ever use the node.
+};
+
+/**
+ * @class NumaPlacement
+ * @brief Chooses the node that NumaStorage created on this thread binds to,
+ * for as long as it is in scope.
+ *
+ * ```cpp
+ * NumaPlacement on_node(1);
+ * BumpUp<1 << 30, NumaStorage<>> arena; // on node 1
+ * ```
+ */
+class NumaPlacement {
+  public:
+    /**
+     * @brief Places storage created on this thread on a node.
+     * @param node The node, or -1 for the node the thread runs on.
+     */
+    explicit NumaPlacement(int node) : previous(target()) { target() = node; }
+
+    NumaPlacement(const NumaPlacement &) = delete;
+    NumaPlacement &operator=(const NumaPlacement &) = delete;
+
+    /**
+     * @brief Gets the node storage created now should bind to.
+     * @return The chosen node, or the node the thread runs on.
+     */
+    static int node() {
+        return target() >= 0 ? target() : numa_current_node();
+    }
+
+    /**
+     * @brief Restores the placement in effect before.
+     */
+    ~NumaPlacement() { target() = previous; }
+
+  private:
+    /**
+     * @brief Gets the chosen node of this thread, -1 if there is none.
+     */
+    static int &target() {
+        thread_local int node = -1;
+        return node;
+    }
+
+    int previous; ///< Placement to restore.
+};
+
+/**
+ * @class NumaStorage
+ * @brief Storage policy that binds its buffer to one NUMA node.
+ * @tparam Storage The storage providing the buffer, usually MmapStorage.
+ * @tparam Policy NUMA_PREFERRED or NUMA_BIND.
+ *
+ * The node is the one chosen by a NumaPlacement in scope, or else the node of
+ * the thread constructing the allocator. Only the policy is set when the
+ * buffer is created. Pages are still placed when they are first touched, but
+ * on that node whichever thread touches them.
+ *
+ * NUMA_PREFERRED falls back to other nodes when the node runs out of memory,
+ * while NUMA_BIND fails the page fault instead.
+ */
+template <class Storage = MmapStorage<>, int Policy = NUMA_PREFERRED>
+class NumaStorage : public Storage {
+  public:
+    /**
+     * @brief Creates the underlying storage and binds it to the node.
+     * @param size Number of bytes in the buffer.
+     */
+    explicit NumaStorage(size_t size)
+        : Storage(size), bound_node(NumaPlacement::node()) {
+        if (numa_node_count() > 1 && !bind(this->data(), size, bound_node))
+            bound_node = -1;
+    }
+
+    /**
+     * @brief Gets the node the buffer is bound to.
+     * @return The node, or -1 if the buffer could not be bound.
+     */
+    int node() { return bound_node; }
+
+  private:
+    /**
+     * @brief Sets the memory policy of the whole pages in a range.
+     */
+    static bool bind(byte *data, size_t size, int node) {
+#ifdef SYS_mbind
+        if (node < 0 || node >= numa_max_nodes)
+            return false;
+
+        static const size_t page = sysconf(_SC_PAGESIZE);
+        uintptr_t first =
+            (reinterpret_cast<uintptr_t>(data) - 1u + page) & -page;
+        uintptr_t last = (reinterpret_cast<uintptr_t>(data) + size) & -page;
+        if (first >= last)
+            return true;
+
+        constexpr int bits = 8 * sizeof(unsigned long);
+        unsigned long mask[numa_max_nodes / bits] = {};
+        mask[node / bits] = 1ul << (node % bits);
+
+        // The kernel reads one bit less than it is told
+        return syscall(SYS_mbind, first, last - first, Policy, mask,
+                       numa_max_nodes + 1, 0) == 0;
+#else
+        (void)data, (void)size, (void)node;
+        return false;
+#endif
+    }
+
+    int bound_node; ///< Node of the buffer, -1 if not bound.
+};
+
+/**
+ * @class NumaArenas
+ * @brief Keeps one arena per NUMA node, and finds the one local to the
+ * calling thread.
+ * @tparam Arena The allocator of every node, normally with NumaStorage, such
+ * as BumpUp<S, NumaStorage<>>.
+ *
+ * Every arena is created under a NumaPlacement for its node. With a single
+ * node there is just one arena, and local() always returns it.
+ *
+ * The arenas are shared by every thread on their node, so they must either be
+ * thread safe or be used by one thread per node, such as a worker pinned to
+ * each node. For an arena per thread, ThreadArenas<BumpUp<S, NumaStorage<>>>
+ * places each thread's arena on the node of the thread that first uses it.
+ *
+ * ```cpp
+ * NumaArenas<BumpUp<1 << 30, NumaStorage<>>> arenas;
+ * auto &arena = arenas.local();
+ * ```
+ */
+template <class Arena> class NumaArenas {
+  public:
+    /**
+     * @brief Constructor for the NumaArenas class.
+     * Creates an arena on every node.
+     */
+    NumaArenas() {
+        for (int node = 0; node < numa_node_count(); node++) {
+            NumaPlacement placement(node);
+            arenas.emplace_back(new Arena());
+        }
+    }
+
+    /**
+     * @brief Gets the arena of the node the calling thread runs on.
+     *
+     * Finding the node takes a system call, so look it up once per request
+     * rather than for every allocation.
+     */
+    Arena &local() { return on(numa_current_node()); }
+
+    /**
+     * @brief Gets the arena of a node.
+     * @param node The node. Nodes the system does not have map to node 0.
+     */
+    Arena &on(int node) {
+        if (node < 0 || node >= get_num_nodes())
+            node = 0;
+        return *arenas[node];
+    }
+
+    /**
+     * @brief Gets the number of nodes, and so of arenas.
+     * @return The number of nodes.
+     */
+    int get_num_nodes() { return arenas.size(); }
+
+  private:
+    std::vector<std::unique_ptr<Arena>> arenas; ///< Arena of every node.
+};
@@ -0,0 +1,113 @@
+#pragma once
+
+/**
+ * @file pmr_balloc.hpp
+ * @brief Defines BumpResource and BumpAllocator, which let standard
+ * containers allocate from a bump allocator.
+ */
+
+#include <cstddef>         // For size_t
+#include <memory_resource> // For std::pmr::memory_resource
+#include <new>             // For std::bad_alloc
+
+/**
+ * @class BumpResource
+ * @brief A std::pmr::memory_resource that allocates from a bump allocator.
+ * @tparam Arena The allocator to draw from, such as BumpUp or BumpDown.
+ *
+ * The resource does not own the arena, so the arena must outlive every
+ * container using it. Deallocation only decrements the arena's allocation
+ * counter, which resets the arena once every allocation has been returned.
+ */
+template <class Arena> class BumpResource : public std::pmr::memory_resource {
+  public:
+    /**
+     * @brief Constructor for the BumpResource class.
+     * @param arena The allocator to draw memory from.
+     */
+    explicit BumpResource(Arena &arena) : arena(arena) {}
+
+  private:
+    /**
+     * @brief Allocates memory from the arena.
+     * @throws std::bad_alloc if the arena is full.
+     */
+    void *do_allocate(size_t bytes, size_t alignment) override {
+        void *p = arena.alloc_bytes(bytes, alignment);
+        if (!p)
+            throw std::bad_alloc();
+        return p;
+    }
+
+    /**
+     * @brief Returns memory to the arena, which only counts it.
+     */
+    void do_deallocate(void *, size_t, size_t) override { arena.dealloc(); }
+
+    /**
+     * @brief Two resources are only interchangeable if they are the same one.
+     */
+    bool do_is_equal(const memory_resource &other) const noexcept override {
+        return this == &other;
+    }
+
+    Arena &arena; ///< Allocator the memory is drawn from.
+};
+
+/**
+ * @class BumpAllocator
+ * @brief A stateful standard allocator that allocates from a bump allocator.
+ * @tparam T The type of elements to allocate.
+ * @tparam Arena The allocator to draw from, such as BumpUp or BumpDown.
+ *
+ * Unlike BumpResource this needs no virtual call, so the typed alloc of the
+ * arena inlines straight into the container.
+ */
+template <class T, class Arena> class BumpAllocator {
+  public:
+    using value_type = T;
+
+    /**
+     * @brief Constructor for the BumpAllocator class.
+     * @param arena The allocator to draw memory from.
+     */
+    explicit BumpAllocator(Arena &arena) noexcept : arena(&arena) {}
+
+    /**
+     * @brief Rebinding constructor used by containers for their node types.
+     */
+    template <class U>
+    BumpAllocator(const BumpAllocator<U, Arena> &other) noexcept
+        : arena(other.arena) {}
+
+    /**
+     * @brief Allocates memory for n elements of type T.
+     * @throws std::bad_alloc if the arena is full.
+     */
+    T *allocate(size_t n) {
+        T *p = arena->template alloc<T>(n);
+        if (!p)
+            throw std::bad_alloc();
+        return p;
+    }
+
+    /**
+     * @brief Returns memory to the arena, which only counts it.
+     */
+    void deallocate(T *, size_t) noexcept { arena->dealloc(); }
+
+    template <class U>
+    bool operator==(const BumpAllocator<U, Arena> &other) const noexcept {
+        return arena == other.arena;
+    }
+
+    template <class U>
+    bool operator!=(const BumpAllocator<U, Arena> &other) const noexcept {
+        return arena != other.arena;
+    }
+
+  private:
+    template <class U, class A> friend class BumpAllocator;
+
+    Arena *arena; ///< Allocator the memory is drawn from.
+};
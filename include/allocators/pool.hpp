@@ -0,0 +1,257 @@
+#pragma once
+
+/**
+ * @file pool.hpp
+ * @brief Defines the SizeClassPool class, which recycles individually freed
+ * objects on top of a bump allocator.
+ */
+
+#include <cstddef> // For size_t and std::max_align_t
+
+using std::byte;
+
+/**
+ * @class SizeClassPool
+ * @brief A pool of fixed-size objects carved from slabs of a bump allocator.
+ * @tparam Arena The allocator slabs come from, such as BumpUp, BumpDown or
+ * Arena, with get_num_resets().
+ * @tparam Sizes The size classes in bytes, in increasing order and each a
+ * multiple of sizeof(void *).
+ *
+ * A request is served from the smallest class that fits it. Every class
+ * keeps an intrusive free list threaded through its freed objects and a slab
+ * it is still bumping through, so allocate and deallocate are O(1): a table
+ * built at compile time maps the size to its class, then an object is popped
+ * from the free list, or bumped from the slab, or a new slab is taken from
+ * the arena.
+ *
+ * Freed objects are reused by later requests of the same class, so a phase
+ * that keeps freeing and allocating stays at its peak number of live objects
+ * instead of growing without bound. Everything is still released at once by
+ * force_dealloc(), on the pool or on the arena itself: the pool compares the
+ * arena's reset count on every call, and starts its classes over once the
+ * arena has been reset. Rewinding the arena to a checkpoint taken before one
+ * of the pool's slabs is not noticed, and is not supported.
+ *
+ * Objects are aligned to the largest power of two dividing their class size,
+ * up to alignof(std::max_align_t).
+ *
+ * ```cpp
+ * BumpUp<1 << 20> arena;
+ * SizeClassPool<BumpUp<1 << 20>, 16, 32, 64, 128> pool(arena);
+ * void *p = pool.allocate(24); // from the 32 byte class
+ * pool.deallocate(p, 24);
+ * ```
+ */
+template <class Arena, size_t... Sizes> class SizeClassPool {
+  public:
+    /**
+     * @brief Constructor for the SizeClassPool class.
+     * @param arena The allocator to take slabs from, which must outlive the
+     * pool.
+     * @param slab_size Bytes taken from the arena whenever a class runs out.
+     */
+    explicit SizeClassPool(Arena &arena, size_t slab_size = 4096)
+        : arena(arena), slab_size(slab_size) {
+        reset_classes();
+    }
+
+    SizeClassPool(const SizeClassPool &) = delete;
+    SizeClassPool &operator=(const SizeClassPool &) = delete;
+
+    /**
+     * @brief Allocates an object of at least size bytes.
+     * @param size Number of bytes needed.
+     * @returns A pointer to the object, or nullptr if size is larger than the
+     * largest class or the arena is full.
+     */
+    void *allocate(size_t size) {
+        if (size > max_size)
+            return nullptr;
+        check_reset();
+
+        SizeClass &c = classes[lookup.index[granules(size)]];
+
+        // Reuse the most recently freed object
+        if (FreeObject *object = c.free) {
+            c.free = object->next;
+            num_allocations++;
+            return object;
+        }
+
+        // Otherwise bump through the class's slab, taking a new one if full
+        if ((size_t)(c.end - c.next) < c.size && !refill(c))
+            return nullptr;
+
+        byte *object = c.next;
+        c.next += c.size;
+        num_allocations++;
+        return object;
+    }
+
+    /**
+     * @brief Returns an object to its class's free list.
+     * @param p An object from allocate(), or nullptr.
+     * @param size The size passed to allocate() for it.
+     */
+    void deallocate(void *p, size_t size) {
+        if (!p)
+            return;
+
+        // An object from before a reset of the arena is already released
+        if (arena.get_num_resets() != seen_resets) {
+            reset_classes();
+            return;
+        }
+
+        SizeClass &c = classes[lookup.index[granules(size)]];
+        FreeObject *object = static_cast<FreeObject *>(p);
+        object->next = c.free;
+        c.free = object;
+        num_allocations--;
+    }
+
+    /**
+     * @brief Allocates memory for one object of type T.
+     * @returns A pointer to the allocated memory, or nullptr if allocation
+     * fails.
+     */
+    template <class T> T *alloc() {
+        static_assert(sizeof(T) <= max_size, "no size class is big enough");
+        return static_cast<T *>(allocate(sizeof(T)));
+    }
+
+    /**
+     * @brief Frees memory from alloc<T>().
+     */
+    template <class T> void dealloc(T *p) { deallocate(p, sizeof(T)); }
+
+    /**
+     * @brief Gets the number of objects allocated and not yet freed.
+     * @return The number of live objects.
+     */
+    int get_num_allocations() {
+        check_reset();
+        return num_allocations;
+    }
+
+    /**
+     * @brief Releases every object at once by resetting the arena, and
+     * empties the free lists that pointed into it.
+     */
+    void force_dealloc() {
+        arena.force_dealloc();
+        reset_classes();
+    }
+
+  private:
+    /**
+     * @brief A freed object, holding the link to the next one.
+     */
+    struct FreeObject {
+        FreeObject *next; ///< Next free object of the same class.
+    };
+
+    /**
+     * @brief The state of one size class.
+     */
+    struct SizeClass {
+        size_t size;      ///< Bytes per object.
+        FreeObject *free; ///< Most recently freed object.
+        byte *next;       ///< Next unused object in the current slab.
+        byte *end;        ///< End of the current slab.
+    };
+
+    static constexpr size_t sizes[] = {Sizes...};
+    static constexpr size_t num_classes = sizeof...(Sizes);
+    static constexpr size_t max_size = sizes[num_classes - 1];
+    static constexpr size_t granule = sizeof(void *);
+
+    /**
+     * @brief Checks the size classes at compile time.
+     */
+    static constexpr bool valid_sizes() {
+        for (size_t i = 0; i < num_classes; i++) {
+            if (sizes[i] == 0 || sizes[i] % granule)
+                return false;
+            if (i > 0 && sizes[i] <= sizes[i - 1])
+                return false;
+        }
+        return true;
+    }
+
+    static_assert(num_classes > 0 && num_classes < 256,
+                  "between 1 and 255 size classes are supported");
+    static_assert(valid_sizes(), "size classes must be increasing multiples "
+                                 "of sizeof(void *)");
+
+    /**
+     * @brief Maps a size, in granules rounded up, to its class.
+     */
+    struct Lookup {
+        unsigned char index[max_size / granule + 1]; ///< Class per granule.
+    };
+
+    /**
+     * @brief Builds the size to class table at compile time.
+     */
+    static constexpr Lookup make_lookup() {
+        Lookup table{};
+        size_t c = 0;
+        for (size_t g = 0; g <= max_size / granule; g++) {
+            while (sizes[c] < g * granule)
+                c++;
+            table.index[g] = c;
+        }
+        return table;
+    }
+
+    static constexpr Lookup lookup = make_lookup();
+
+    /**
+     * @brief Gets the number of granules needed for size bytes.
+     */
+    static size_t granules(size_t size) {
+        return (size + granule - 1) / granule;
+    }
+
+    /**
+     * @brief Starts every class over with an empty free list and no slab.
+     */
+    void reset_classes() {
+        for (size_t i = 0; i < num_classes; i++)
+            classes[i] = {sizes[i], nullptr, nullptr, nullptr};
+        num_allocations = 0;
+        seen_resets = arena.get_num_resets();
+    }
+
+    /**
+     * @brief Forgets the free lists and slabs if the arena was reset since
+     * they were taken, since its memory is being handed out again.
+     */
+    void check_reset() {
+        if (arena.get_num_resets() != seen_resets)
+            reset_classes();
+    }
+
+    /**
+     * @brief Takes a new slab from the arena for a class.
+     * @returns false if the arena is full.
+     */
+    bool refill(SizeClass &c) {
+        size_t count = slab_size > c.size ? slab_size / c.size : 1;
+        byte *slab = arena.alloc_bytes(count * c.size,
+                                       alignof(std::max_align_t));
+        if (!slab)
+            return false;
+        c.next = slab;
+        c.end = slab + count * c.size;
+        return true;
+    }
+
+    Arena &arena;                   ///< Allocator slabs come from.
+    size_t slab_size;               ///< Bytes per slab.
+    SizeClass classes[num_classes]; ///< State of every size class.
+    int num_allocations;            ///< Number of live objects.
+    unsigned seen_resets;           ///< Arena resets the classes are from.
+};
@@ -0,0 +1,213 @@
+#pragma once
+
+/**
+ * @file ring_balloc.hpp
+ * @brief Defines the RingBump class, a bump allocator that wraps around its
+ * buffer and frees in allocation order.
+ */
+
+#include <atomic>      // For std::atomic
+#include <cstddef>     // For size_t
+#include <cstdint>     // For uintptr_t
+#include <type_traits> // For std::void_t
+
+#include "storage.hpp" // For HeapStorage
+
+using std::byte;
+
+/**
+ * @brief Whether a storage policy maps its buffer twice in a row, like
+ * MirroredStorage. False unless the policy says otherwise.
+ */
+template <class Storage, class = void> struct is_mirrored : std::false_type {};
+
+template <class Storage>
+struct is_mirrored<Storage, std::void_t<decltype(Storage::mirrored)>>
+    : std::bool_constant<Storage::mirrored> {};
+
+/**
+ * @class RingBump
+ * @brief A bump-pointer allocator over a circular buffer, for data that is
+ * freed in the order it was allocated.
+ * @tparam S The size of the memory buffer, a power of two.
+ * @tparam Storage Policy providing the buffer, such as HeapStorage or
+ * MirroredStorage.
+ * @tparam Concurrent Whether one thread allocates while another releases.
+ *
+ * Allocation bumps the head forward and release() moves the tail past the
+ * oldest allocation, so memory used by a queue of messages or a log stays
+ * bounded without waiting for the whole buffer to empty. Every allocation
+ * starts with a header holding its length, which is all release() needs.
+ *
+ * An allocation that does not fit before the end of the buffer normally
+ * starts over at the beginning, and the space it skipped is freed with it.
+ * With MirroredStorage the end of the buffer runs on into its start, so an
+ * allocation simply continues across the wrap and nothing is skipped.
+ *
+ * With Concurrent set, one producer thread may allocate while one consumer
+ * thread releases, without locks: the head and the tail are each written by
+ * one side only, and published with release and acquire ordering. Otherwise
+ * the same operations are relaxed.
+ *
+ * ```cpp
+ * RingBump<1 << 20, MirroredStorage, true> ring;
+ * // producer:
+ * Message *m = ring.alloc<Message>(1);
+ * // consumer, once done with the oldest message:
+ * ring.release();
+ * ```
+ */
+template <size_t S, class Storage = HeapStorage, bool Concurrent = false>
+class RingBump {
+    static_assert(S >= 2 * sizeof(size_t) && (S & (S - 1)) == 0,
+                  "the ring's size must be a power of two");
+    static_assert(!is_mirrored<Storage>::value || S >= 4096,
+                  "a mirrored ring must be at least one page");
+
+  public:
+    /**
+     * @brief Constructor for the RingBump class.
+     * Initializes the memory buffer, with the head and tail at its start.
+     */
+    RingBump() : storage(S), head(0), seen_tail(0), tail(0), seen_head(0) {
+        start = storage.data();
+    }
+
+    RingBump(const RingBump &) = delete;
+    RingBump &operator=(const RingBump &) = delete;
+
+    /**
+     * @brief Allocates memory for an array of elements of type T.
+     *
+     * @tparam T The type of elements to allocate.
+     * @param n Number of elements to allocate space for.
+     * @returns A pointer to the allocated memory, or nullptr if the ring is
+     * too full.
+     */
+    template <class T> T *alloc(size_t n) {
+        return reinterpret_cast<T *>(alloc_bytes(sizeof(T) * n, alignof(T)));
+    }
+
+    /**
+     * @brief Allocates raw memory at the head of the ring.
+     *
+     * @param size Number of bytes to allocate.
+     * @param alignment Alignment of the returned pointer, must be a power of
+     * two.
+     * @returns A pointer to the allocated memory, or nullptr if it does not
+     * fit in the space released so far.
+     */
+    byte *alloc_bytes(size_t size, size_t alignment) {
+        size_t old_head = head.load(std::memory_order_relaxed);
+        size_t pos = old_head & (S - 1);
+
+        // Calculate the aligned memory location after the header
+        byte *aligned = align(start + pos + sizeof(size_t), alignment);
+        size_t end = aligned + size - start;
+
+        // Without a mirror, start over at the beginning if it overruns
+        if (!is_mirrored<Storage>::value && end > S) {
+            aligned = align(start, alignment);
+            end = S + (aligned + size - start);
+        }
+
+        // Check the length, rounded so the next header is aligned, against
+        // the space released so far, asking the consumer only when needed
+        size_t length = ((end - 1u + sizeof(size_t)) & -sizeof(size_t)) - pos;
+        if (length > S - (old_head - seen_tail)) {
+            seen_tail = tail.load(load_order);
+            if (length > S - (old_head - seen_tail))
+                return nullptr;
+        }
+
+        // Write the header and publish the new head
+        *reinterpret_cast<size_t *>(start + pos) = length;
+        head.store(old_head + length, store_order);
+        return aligned;
+    }
+
+    /**
+     * @brief Frees the oldest allocation still in the ring, if there is one.
+     */
+    void release() {
+        size_t old_tail = tail.load(std::memory_order_relaxed);
+        if (old_tail == seen_head) {
+            seen_head = head.load(load_order);
+            if (old_tail == seen_head)
+                return;
+        }
+
+        size_t length =
+            *reinterpret_cast<size_t *>(start + (old_tail & (S - 1)));
+        tail.store(old_tail + length, store_order);
+    }
+
+    /**
+     * @brief Checks whether every allocation has been released.
+     */
+    bool empty() {
+        return head.load(load_order) == tail.load(load_order);
+    }
+
+    /**
+     * @brief Gets the number of bytes between the tail and the head,
+     * including headers, padding and skipped space.
+     * @return The used bytes.
+     */
+    size_t used() { return head.load(load_order) - tail.load(load_order); }
+
+    /**
+     * @brief Gets the size of the allocator's buffer.
+     * @return The capacity in bytes.
+     */
+    size_t capacity() { return S; }
+
+    /**
+     * @brief Checks whether a pointer lies in the allocator's buffer, or in
+     * its mirror.
+     * @param p The pointer to check.
+     * @return true if p points into the buffer.
+     */
+    bool owns(const void *p) {
+        const byte *b = static_cast<const byte *>(p);
+        return b >= start &&
+               b < start + (is_mirrored<Storage>::value ? 2 * S : S);
+    }
+
+    /**
+     * @brief Forces deallocation of all memory. Neither side may be using
+     * the ring at the same time.
+     */
+    void force_dealloc() {
+        head.store(0, std::memory_order_relaxed);
+        tail.store(0, std::memory_order_relaxed);
+        seen_head = 0;
+        seen_tail = 0;
+    }
+
+  private:
+    /// Ordering of loads from the other side.
+    static constexpr std::memory_order load_order =
+        Concurrent ? std::memory_order_acquire : std::memory_order_relaxed;
+
+    /// Ordering of stores seen by the other side.
+    static constexpr std::memory_order store_order =
+        Concurrent ? std::memory_order_release : std::memory_order_relaxed;
+
+    /**
+     * @brief Rounds a pointer up to a power of two alignment.
+     */
+    static byte *align(byte *p, size_t alignment) {
+        return reinterpret_cast<byte *>(
+            (reinterpret_cast<uintptr_t>(p) - 1u + alignment) & -alignment);
+    }
+
+    Storage storage; ///< Owner of the allocated memory buffer.
+    byte *start;     ///< Start of the allocated memory buffer.
+
+    // The producer's and the consumer's fields are on separate cache lines
+    alignas(64) std::atomic<size_t> head; ///< Bytes ever allocated.
+    size_t seen_tail;                     ///< Last tail the producer read.
+    alignas(64) std::atomic<size_t> tail; ///< Bytes ever released.
+    size_t seen_head;                     ///< Last head the consumer read.
+};
@@ -0,0 +1,45 @@
+#pragma once
+
+/**
+ * @file scope.hpp
+ * @brief Defines the BumpScope class, which frees everything allocated in a
+ * scope when the scope exits.
+ */
+
+/**
+ * @class BumpScope
+ * @brief Takes a checkpoint of an allocator and rewinds to it on destruction.
+ * @tparam Arena An allocator with mark() and rewind(), such as BumpUp or
+ * BumpDown.
+ *
+ * Nesting scopes makes the peak memory of a sequence of phases the largest
+ * single phase instead of their sum.
+ *
+ * ```cpp
+ * BumpScope<BumpUp<4096>> scope(arena);
+ * char *scratch = arena.alloc<char>(256); // freed when scope ends
+ * ```
+ */
+template <class Arena> class BumpScope {
+  public:
+    /**
+     * @brief Constructor for the BumpScope class.
+     * @param arena The allocator to rewind when the scope ends.
+     */
+    explicit BumpScope(Arena &arena) : arena(arena) {
+        checkpoint = arena.mark();
+    }
+
+    BumpScope(const BumpScope &) = delete;
+    BumpScope &operator=(const BumpScope &) = delete;
+
+    /**
+     * @brief Destructor for the BumpScope class.
+     * Rewinds the allocator to where it was when the scope started.
+     */
+    ~BumpScope() { arena.rewind(checkpoint); }
+
+  private:
+    Arena &arena;                          ///< Allocator being scoped.
+    typename Arena::Checkpoint checkpoint; ///< Position to rewind to.
+};
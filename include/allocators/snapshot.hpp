@@ -0,0 +1,281 @@
+#pragma once
+
+/**
+ * @file snapshot.hpp
+ * @brief Defines arena_ptr, a pointer that stays valid when the memory it is
+ * in moves, and snapshots, which save the used part of an arena to a file and
+ * map it back in.
+ */
+
+#include <cstddef>    // For size_t and ptrdiff_t
+#include <cstdint>    // For uintptr_t and uint64_t
+#include <cstring>    // For std::memcmp
+#include <fcntl.h>    // For open
+#include <fstream>    // For std::ofstream
+#include <sys/mman.h> // For mmap and munmap
+#include <sys/stat.h> // For fstat
+#include <unistd.h>   // For close and sysconf
+
+using std::byte;
+
+/**
+ * @class arena_ptr
+ * @brief A pointer stored as the distance from itself to its target.
+ * @tparam T The type pointed to.
+ *
+ * Moving a whole block of memory, with both the arena_ptr and its target in
+ * it, leaves the distance and so the pointer intact. Data made of arena_ptr
+ * and plain values can therefore be saved with save_snapshot() and used
+ * straight from a Snapshot mapped at any address. Copying an arena_ptr to
+ * another place recomputes the distance, so the copy points to the same
+ * target.
+ *
+ * A distance of 1 stands for nullptr, since no object can start inside the
+ * arena_ptr itself.
+ *
+ * A const arena_ptr only gives const access to its target, so data reached
+ * from the const root of a Snapshot, which is mapped read-only, stays const
+ * all the way down.
+ */
+template <class T> class arena_ptr {
+  public:
+    /**
+     * @brief Constructs a null pointer.
+     */
+    arena_ptr() : offset(null_offset) {}
+
+    /**
+     * @brief Constructs a pointer to p.
+     */
+    arena_ptr(T *p) { set(p); }
+
+    /**
+     * @brief Constructs a pointer to the target of another one.
+     */
+    arena_ptr(const arena_ptr &other) { set(other.get()); }
+
+    arena_ptr &operator=(const arena_ptr &other) {
+        set(other.get());
+        return *this;
+    }
+
+    arena_ptr &operator=(T *p) {
+        set(p);
+        return *this;
+    }
+
+    /**
+     * @brief Gets the target as a plain pointer.
+     */
+    T *get() {
+        if (offset == null_offset)
+            return nullptr;
+        return reinterpret_cast<T *>(reinterpret_cast<uintptr_t>(this) +
+                                     offset);
+    }
+
+    /**
+     * @brief Gets the target as a plain pointer to const.
+     */
+    const T *get() const { return const_cast<arena_ptr *>(this)->get(); }
+
+    T &operator*() { return *get(); }
+    const T &operator*() const { return *get(); }
+    T *operator->() { return get(); }
+    const T *operator->() const { return get(); }
+    T &operator[](size_t i) { return get()[i]; }
+    const T &operator[](size_t i) const { return get()[i]; }
+    explicit operator bool() const { return offset != null_offset; }
+
+  private:
+    static constexpr ptrdiff_t null_offset = 1;
+
+    /**
+     * @brief Stores the distance from this pointer to p.
+     */
+    void set(const T *p) {
+        if (!p) {
+            offset = null_offset;
+            return;
+        }
+        offset = static_cast<ptrdiff_t>(reinterpret_cast<uintptr_t>(p) -
+                                        reinterpret_cast<uintptr_t>(this));
+    }
+
+    ptrdiff_t offset; ///< Distance in bytes from this to the target.
+};
+
+/**
+ * @brief The header at the start of a snapshot file.
+ */
+struct SnapshotHeader {
+    char magic[8];        ///< Always "BUMPSNAP".
+    uint64_t version;     ///< Format version, currently 1.
+    uint64_t data_offset; ///< Where the arena's bytes start in the file.
+    uint64_t size;        ///< Number of bytes saved.
+    uint64_t root;        ///< Offset of the root object in those bytes.
+};
+
+/// Identifies a snapshot file.
+constexpr char snapshot_magic[8] = {'B', 'U', 'M', 'P', 'S', 'N', 'A', 'P'};
+
+/**
+ * @brief Saves the memory in use by an arena to a file.
+ *
+ * @tparam Arena An allocator with data() and used(), such as BumpUp or
+ * BumpDown.
+ * @param arena The arena to save.
+ * @param root The object to find again after loading, inside the arena.
+ * @param path The file to write.
+ * @returns true if the file was written, false if it could not be or root is
+ * not in use in the arena.
+ *
+ * Only the bytes in use are written, [data(), data() + used()). They are
+ * placed in the file so that their offset within a page is the same as in
+ * memory. A Snapshot maps them page aligned, so every object keeps its
+ * alignment, up to the page size.
+ *
+ * The saved objects must not hold plain pointers, which would point back
+ * into this process. Use arena_ptr, or offsets, between them instead.
+ *
+ * ```cpp
+ * BumpUp<1 << 20> arena;
+ * Table *table = build_table(arena);
+ * save_snapshot(arena, table, "table.snap");
+ * ```
+ */
+template <class Arena>
+bool save_snapshot(Arena &arena, const void *root, const char *path) {
+    const byte *data = arena.data();
+    size_t size = arena.used();
+    const byte *r = static_cast<const byte *>(root);
+    if (r < data || r >= data + size)
+        return false;
+
+    // Keep the data at the same position within a page as in memory
+    static const size_t page = sysconf(_SC_PAGESIZE);
+    SnapshotHeader header;
+    std::memcpy(header.magic, snapshot_magic, sizeof(header.magic));
+    header.version = 1;
+    header.data_offset =
+        page + (reinterpret_cast<uintptr_t>(data) & (page - 1));
+    header.size = size;
+    header.root = r - data;
+
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    for (size_t i = sizeof(header); i < header.data_offset; i++)
+        file.put(0);
+    file.write(reinterpret_cast<const char *>(data), size);
+    return static_cast<bool>(file.flush());
+}
+
+/**
+ * @class Snapshot
+ * @brief A snapshot file mapped read-only into memory.
+ *
+ * The objects are used where they are mapped, with no copying or fixing up
+ * of pointers, so loading costs only the page faults of the pages that are
+ * read. Several processes mapping the same file share its pages.
+ *
+ * The mapping is read-only. Writing through a pointer from the snapshot
+ * crashes.
+ *
+ * ```cpp
+ * Snapshot snapshot("table.snap");
+ * if (const Table *table = snapshot.root<Table>())
+ *     lookup(*table, key);
+ * ```
+ */
+class Snapshot {
+  public:
+    /**
+     * @brief Maps a snapshot file.
+     * @param path The file written by save_snapshot().
+     *
+     * If the file cannot be opened or is not a valid snapshot, the snapshot
+     * is empty and root() returns nullptr.
+     */
+    explicit Snapshot(const char *path) : mapping(nullptr), mapped_size(0) {
+        int fd = open(path, O_RDONLY | O_CLOEXEC);
+        if (fd < 0)
+            return;
+
+        struct stat st;
+        if (fstat(fd, &st) == 0 &&
+            (size_t)st.st_size >= sizeof(SnapshotHeader)) {
+            void *p = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (p != MAP_FAILED) {
+                mapping = static_cast<byte *>(p);
+                mapped_size = st.st_size;
+            }
+        }
+        close(fd);
+
+        if (mapping && !valid()) {
+            munmap(mapping, mapped_size);
+            mapping = nullptr;
+        }
+    }
+
+    Snapshot(const Snapshot &) = delete;
+    Snapshot &operator=(const Snapshot &) = delete;
+
+    /**
+     * @brief Checks whether the file was mapped.
+     */
+    explicit operator bool() const { return mapping != nullptr; }
+
+    /**
+     * @brief Gets the root object passed to save_snapshot().
+     * @tparam T The type of the root object.
+     * @return The root, or nullptr if the snapshot is empty or too small to
+     * hold a T at the root.
+     */
+    template <class T> const T *root() const {
+        if (!mapping || header()->size - header()->root < sizeof(T))
+            return nullptr;
+        return reinterpret_cast<const T *>(data() + header()->root);
+    }
+
+    /**
+     * @brief Gets the first byte of the saved memory.
+     */
+    const byte *data() const {
+        return mapping ? mapping + header()->data_offset : nullptr;
+    }
+
+    /**
+     * @brief Gets the number of bytes of saved memory.
+     */
+    size_t size() const { return mapping ? header()->size : 0; }
+
+    /**
+     * @brief Unmaps the file.
+     */
+    ~Snapshot() {
+        if (mapping)
+            munmap(mapping, mapped_size);
+    }
+
+  private:
+    /**
+     * @brief Gets the header at the start of the mapping.
+     */
+    const SnapshotHeader *header() const {
+        return reinterpret_cast<const SnapshotHeader *>(mapping);
+    }
+
+    /**
+     * @brief Checks the header against the file.
+     */
+    bool valid() const {
+        const SnapshotHeader *h = header();
+        return std::memcmp(h->magic, snapshot_magic, sizeof(h->magic)) == 0 &&
+               h->version == 1 && h->data_offset <= mapped_size &&
+               h->size <= mapped_size - h->data_offset && h->root < h->size;
+    }
+
+    byte *mapping;      ///< Start of the mapped file.
+    size_t mapped_size; ///< Size of the mapped file.
+};
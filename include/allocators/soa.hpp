@@ -0,0 +1,147 @@
+#pragma once
+
+/**
+ * @file soa.hpp
+ * @brief Defines alloc_soa, which allocates a struct of arrays in a single
+ * bump, and the SoaView and Span types used to access it.
+ */
+
+#include <cstddef> // For size_t
+#include <tuple>   // For std::tuple
+#include <utility> // For std::index_sequence
+
+#include "batch.hpp" // For BatchLayout
+
+using std::byte;
+
+/**
+ * @brief Alignment of every field array made by alloc_soa: one cache line,
+ * which is also enough for AVX-512 loads.
+ */
+constexpr size_t soa_alignment = 64;
+
+/**
+ * @class Span
+ * @brief A pointer and a length, for iterating over one field array.
+ * @tparam T The element type.
+ */
+template <class T> class Span {
+  public:
+    /**
+     * @brief Constructs a span over n elements starting at data.
+     */
+    Span(T *data, size_t n) : first(data), length(n) {}
+
+    T *data() const { return first; }
+    size_t size() const { return length; }
+    T *begin() const { return first; }
+    T *end() const { return first + length; }
+    T &operator[](size_t i) const { return first[i]; }
+
+  private:
+    T *first;      ///< First element.
+    size_t length; ///< Number of elements.
+};
+
+/**
+ * @class SoaView
+ * @brief Gives access to n elements stored as one array per field.
+ * @tparam Fields The type of every field, in order.
+ *
+ * field<I>() is the whole array of field I, which is what a loop over one
+ * field of many elements should use. view[i] is a tuple of references to the
+ * fields of element i, for code that works on whole elements:
+ *
+ * ```cpp
+ * auto [x, vx] = particles[i];
+ * x += vx;
+ * ```
+ */
+template <class... Fields> class SoaView {
+  public:
+    /**
+     * @brief Constructs an empty view, the result of a failed allocation.
+     */
+    SoaView() : arrays(), n(0) {}
+
+    /**
+     * @brief Constructs a view over field arrays of n elements each.
+     */
+    SoaView(std::tuple<Fields *...> arrays, size_t n)
+        : arrays(arrays), n(n) {}
+
+    /**
+     * @brief Checks whether the allocation succeeded.
+     */
+    explicit operator bool() const { return std::get<0>(arrays) != nullptr; }
+
+    /**
+     * @brief Gets the number of elements.
+     */
+    size_t size() const { return n; }
+
+    /**
+     * @brief Gets the array of field I.
+     */
+    template <size_t I> auto field() const {
+        return Span(std::get<I>(arrays), n);
+    }
+
+    /**
+     * @brief Gets references to every field of element i.
+     */
+    std::tuple<Fields &...> operator[](size_t i) const {
+        return element(i, std::index_sequence_for<Fields...>());
+    }
+
+  private:
+    template <size_t... I>
+    std::tuple<Fields &...> element(size_t i,
+                                    std::index_sequence<I...>) const {
+        return {std::get<I>(arrays)[i]...};
+    }
+
+    std::tuple<Fields *...> arrays; ///< First element of every field.
+    size_t n;                       ///< Number of elements.
+};
+
+/**
+ * @brief Allocates n elements as one array per field, in a single bump.
+ *
+ * @tparam Fields The type of every field.
+ * @tparam Arena Any allocator with alloc_bytes(), such as BumpUp, BumpDown,
+ * Arena or BumpChain.
+ * @param arena The allocator to take the memory from.
+ * @param n Number of elements.
+ * @returns A view of the arrays, which is empty if allocation fails.
+ *
+ * Every field array starts on a soa_alignment boundary, so a loop over one
+ * field can use aligned vector loads from its first element. The arrays are
+ * one block, which counts as a single allocation of the arena.
+ *
+ * ```cpp
+ * auto particles = alloc_soa<float, float, float>(arena, 4096);
+ * for (float &x : particles.field<0>())
+ *     x = 0;
+ * ```
+ */
+template <class... Fields, class Arena>
+SoaView<Fields...> alloc_soa(Arena &arena, size_t n) {
+    static_assert(sizeof...(Fields) > 0, "a struct of arrays needs a field");
+    static_assert(((alignof(Fields) <= soa_alignment) && ...),
+                  "field alignment is larger than soa_alignment");
+
+    // Round every array up to whole cache lines, so the next one is aligned
+    const size_t sizes[] = {sizeof(Fields) * n...};
+    size_t offsets[sizeof...(Fields)];
+    size_t total = 0;
+    for (size_t i = 0; i < sizeof...(Fields); i++) {
+        offsets[i] = total;
+        total += (sizes[i] + soa_alignment - 1) & -soa_alignment;
+    }
+
+    byte *base = arena.alloc_bytes(total, soa_alignment);
+    if (!base)
+        return {};
+    return {BatchLayout<Fields...>::pointers(base, offsets), n};
+}
@@ -0,0 +1,138 @@
+#pragma once
+
+/**
+ * @file stats.hpp
+ * @brief Defines the statistics policies of the bump allocators, NoStats and
+ * BumpStats.
+ */
+
+#include <cstddef> // For size_t
+#include <ostream> // For std::ostream
+
+/**
+ * @class NoStats
+ * @brief The default statistics policy, which records nothing.
+ *
+ * Every hook is empty and the class has no members. The allocators inherit
+ * from their policy, so the empty base takes no space and the calls compile
+ * away.
+ */
+class NoStats {
+  protected:
+    void record_alloc(size_t, size_t, size_t) {}
+    void record_failure(size_t) {}
+    void record_resize(size_t) {}
+};
+
+/**
+ * @class BumpStats
+ * @brief A statistics policy that records how an allocator is used.
+ *
+ * Tracks the peak number of bytes in use, the bytes lost to alignment
+ * padding, how many allocations failed and a log2 histogram of request
+ * sizes. Counters survive force_dealloc(), so they describe the allocator's
+ * whole lifetime, or the time since reset_stats().
+ */
+class BumpStats {
+  public:
+    /**
+     * @brief Number of histogram buckets. Bucket 0 counts empty requests and
+     * bucket k counts sizes from 2^(k-1) to 2^k - 1.
+     */
+    static constexpr int num_buckets = 8 * sizeof(size_t) + 1;
+
+    /**
+     * @brief A copy of the counters at one point in time.
+     */
+    struct Snapshot {
+        size_t high_water;    ///< Most bytes in use at once.
+        size_t requested;     ///< Bytes asked for by successful allocations.
+        size_t padding;       ///< Bytes skipped to align allocations.
+        size_t num_allocs;    ///< Successful allocations.
+        size_t num_failures;  ///< Allocations that returned nullptr.
+        size_t histogram[num_buckets]; ///< Request sizes by power of two.
+    };
+
+    /**
+     * @brief Gets a copy of the counters.
+     */
+    Snapshot snapshot() const { return counters; }
+
+    /**
+     * @brief Sets every counter back to zero.
+     */
+    void reset_stats() { counters = {}; }
+
+    /**
+     * @brief Prints the counters in a readable form.
+     * @param out The stream to write to.
+     * @param capacity The allocator's capacity, to show the peak against.
+     */
+    void report(std::ostream &out, size_t capacity) const {
+        const Snapshot &c = counters;
+        out << "high water: " << c.high_water << " of " << capacity
+            << " bytes (" << (capacity ? 100 * c.high_water / capacity : 0)
+            << "%)\n"
+            << "allocations: " << c.num_allocs << ", failed "
+            << c.num_failures << "\n"
+            << "requested: " << c.requested << " bytes, padding "
+            << c.padding << " bytes\n"
+            << "sizes:\n";
+        for (int k = 0; k < num_buckets; k++) {
+            if (!c.histogram[k])
+                continue;
+            size_t low = k ? (size_t)1 << (k - 1) : 0;
+            size_t high = k ? low * 2 - 1 : 0;
+            out << "  " << low << "-" << high << ": " << c.histogram[k]
+                << "\n";
+        }
+    }
+
+  protected:
+    /**
+     * @brief Records a successful allocation.
+     * @param size Bytes requested.
+     * @param padding Bytes skipped for alignment.
+     * @param used Bytes in use after the allocation.
+     */
+    void record_alloc(size_t size, size_t padding, size_t used) {
+        counters.num_allocs++;
+        counters.requested += size;
+        counters.padding += padding;
+        counters.histogram[bucket(size)]++;
+        record_resize(used);
+    }
+
+    /**
+     * @brief Records an allocation that did not fit.
+     * @param size Bytes requested.
+     */
+    void record_failure(size_t size) {
+        counters.num_failures++;
+        counters.histogram[bucket(size)]++;
+    }
+
+    /**
+     * @brief Records an allocation growing or shrinking in place.
+     * @param used Bytes in use afterwards.
+     */
+    void record_resize(size_t used) {
+        if (used > counters.high_water)
+            counters.high_water = used;
+    }
+
+  private:
+    /**
+     * @brief Gets the histogram bucket of a request size.
+     */
+    static int bucket(size_t size) {
+        int k = 0;
+        while (size) {
+            size >>= 1;
+            k++;
+        }
+        return k;
+    }
+
+    Snapshot counters = {}; ///< Counters since construction or reset.
+};
@@ -0,0 +1,432 @@
+#pragma once
+
+/**
+ * @file storage.hpp
+ * @brief Defines the storage policies that provide the memory buffer behind
+ * the bump allocators.
+ */
+
+#include <cstddef>     // For size_t
+#include <cstdint>     // For uintptr_t
+#include <fstream>     // For std::ifstream
+#include <new>         // For std::bad_alloc
+#include <stdexcept>   // For std::invalid_argument
+#include <string>      // For std::string
+#include <sys/mman.h>  // For mmap, madvise, memfd_create and munmap
+#include <type_traits> // For std::void_t
+#include <unistd.h>    // For ftruncate, close and sysconf
+#include <utility>     // For std::declval
+
+using std::byte;
+
+/**
+ * @class HeapStorage
+ * @brief Storage policy that gets the buffer from operator new.
+ *
+ * This is the default, and matches what the allocators always did.
+ */
+class HeapStorage {
+  public:
+    /**
+     * @brief Allocates a buffer of the given size.
+     * @param size Number of bytes in the buffer.
+     */
+    explicit HeapStorage(size_t size) { start = new byte[size]; }
+
+    HeapStorage(const HeapStorage &) = delete;
+    HeapStorage &operator=(const HeapStorage &) = delete;
+
+    /**
+     * @brief Gets the start of the buffer.
+     */
+    byte *data() { return start; }
+
+    /**
+     * @brief Deallocates the buffer.
+     */
+    ~HeapStorage() { delete[] start; }
+
+  private:
+    byte *start; ///< Start of the allocated memory buffer.
+};
+
+/**
+ * @brief Options for MmapStorage, combined with bitwise or.
+ */
+enum MmapOptions : unsigned {
+    MMAP_LAZY = 0,       ///< Reserve only, pages commit on first touch.
+    MMAP_HUGE_PAGES = 1, ///< Ask for transparent huge pages with madvise.
+    MMAP_HUGETLB = 2,    ///< Map from the hugetlbfs pool with MAP_HUGETLB.
+    MMAP_POPULATE = 4,   ///< Prefault every page up front with MAP_POPULATE.
+};
+
+/**
+ * @class MmapStorage
+ * @brief Storage policy that maps the buffer straight from the kernel.
+ * @tparam Options A combination of MmapOptions.
+ *
+ * The address space for the whole buffer is reserved in the constructor but,
+ * unless MMAP_POPULATE is given, a page only costs memory once it is touched.
+ * With MMAP_HUGE_PAGES the mapping is aligned to a huge page boundary so the
+ * kernel can back it with 2MB pages. MMAP_HUGETLB needs pages reserved in
+ * /proc/sys/vm/nr_hugepages and quietly falls back to normal pages otherwise.
+ *
+ * The transparent huge page size is taken to be HUGE_PAGE_SIZE, the one of
+ * x86-64. On architectures with larger ones, such as arm64 with 64KB base
+ * pages, the alignment is too small for the kernel to use them. MMAP_HUGETLB
+ * rounds to the default hugetlbfs page size read from /proc/meminfo instead.
+ */
+template <unsigned Options = MMAP_LAZY> class MmapStorage {
+  public:
+    static constexpr size_t HUGE_PAGE_SIZE = 2 << 20; ///< x86-64 huge page.
+
+    /**
+     * @brief Maps a buffer of the given size.
+     * @param size Number of bytes in the buffer.
+     * @throws std::bad_alloc if the mapping fails.
+     */
+    explicit MmapStorage(size_t size) {
+        int flags = MAP_PRIVATE | MAP_ANONYMOUS;
+#ifdef MAP_NORESERVE
+        flags |= MAP_NORESERVE;
+#endif
+#ifdef MAP_POPULATE
+        if (Options & MMAP_POPULATE)
+            flags |= MAP_POPULATE;
+#endif
+
+        start = nullptr;
+#ifdef MAP_HUGETLB
+        if (Options & MMAP_HUGETLB) {
+            // Without MAP_NORESERVE the mapping fails up front when the pool
+            // is empty, instead of raising SIGBUS on first touch
+            int huge_flags = flags | MAP_HUGETLB;
+#ifdef MAP_NORESERVE
+            huge_flags &= ~MAP_NORESERVE;
+#endif
+            mapped_size = round_up(size, hugetlb_page_size());
+            start = map(mapped_size, huge_flags);
+            mapping = start;
+        }
+#endif
+        if (!start) {
+            if (Options & MMAP_HUGE_PAGES) {
+                // Over-reserve so a huge page aligned start can be chosen.
+                // Prefaulting waits until the pages can be huge, and skips
+                // the slack around the buffer.
+                int lazy_flags = flags;
+#ifdef MAP_POPULATE
+                lazy_flags &= ~MAP_POPULATE;
+#endif
+                mapped_size = round_up(size, HUGE_PAGE_SIZE) + HUGE_PAGE_SIZE;
+                mapping = map(mapped_size, lazy_flags);
+                start = reinterpret_cast<byte *>(
+                    round_up(reinterpret_cast<uintptr_t>(mapping),
+                             HUGE_PAGE_SIZE));
+                if (mapping) {
+#ifdef MADV_HUGEPAGE
+                    madvise(start, round_up(size, HUGE_PAGE_SIZE),
+                            MADV_HUGEPAGE);
+#endif
+                    if (Options & MMAP_POPULATE)
+                        prefault(start, size);
+                }
+            } else {
+                mapped_size = size;
+                mapping = map(mapped_size, flags);
+                start = mapping;
+            }
+        }
+
+        if (!start)
+            throw std::bad_alloc();
+    }
+
+    MmapStorage(const MmapStorage &) = delete;
+    MmapStorage &operator=(const MmapStorage &) = delete;
+
+    /**
+     * @brief Gets the start of the buffer.
+     */
+    byte *data() { return start; }
+
+    /**
+     * @brief Unmaps the buffer.
+     */
+    ~MmapStorage() { munmap(mapping, mapped_size); }
+
+  private:
+    /**
+     * @brief Gets the size of the pages MAP_HUGETLB maps, the Hugepagesize
+     * line of /proc/meminfo.
+     * @return The size, HUGE_PAGE_SIZE if the file does not say.
+     */
+    static size_t hugetlb_page_size() {
+        static const size_t size = [] {
+            std::ifstream meminfo("/proc/meminfo");
+            std::string key;
+            size_t kb;
+            while (meminfo >> key >> kb) {
+                if (key == "Hugepagesize:" && kb > 0)
+                    return kb << 10;
+                meminfo.ignore(256, '\n');
+            }
+            return HUGE_PAGE_SIZE;
+        }();
+        return size;
+    }
+
+    /**
+     * @brief Faults in every page of a range, writable.
+     *
+     * MADV_POPULATE_WRITE does it in one call from Linux 5.14. Older kernels
+     * get a write to every page instead, which reads as the zero it already
+     * holds.
+     */
+    static void prefault(byte *p, size_t size) {
+#ifdef MADV_POPULATE_WRITE
+        if (madvise(p, size, MADV_POPULATE_WRITE) == 0)
+            return;
+#endif
+        static const size_t page = sysconf(_SC_PAGESIZE);
+        for (size_t i = 0; i < size; i += page)
+            reinterpret_cast<volatile byte *>(p)[i] = byte{0};
+    }
+
+    /**
+     * @brief Maps anonymous memory, returning nullptr on failure.
+     */
+    static byte *map(size_t size, int flags) {
+        void *p = mmap(nullptr, size, PROT_READ | PROT_WRITE, flags, -1, 0);
+        return p == MAP_FAILED ? nullptr : static_cast<byte *>(p);
+    }
+
+    /**
+     * @brief Rounds a value up to a power of two boundary.
+     */
+    static constexpr uintptr_t round_up(uintptr_t value, size_t boundary) {
+        return (value - 1u + boundary) & -boundary;
+    }
+
+    byte *start;        ///< Start of the usable buffer.
+    byte *mapping;      ///< Start of the whole mapping.
+    size_t mapped_size; ///< Size of the whole mapping.
+};
+
+#ifdef MFD_CLOEXEC
+/**
+ * @class MirroredStorage
+ * @brief Storage policy that maps the same pages twice in a row, so the
+ * buffer's end continues into its own start. Linux only.
+ *
+ * Writing past the end of the buffer writes to its beginning, which lets a
+ * ring buffer hand out records that wrap around as one contiguous block. The
+ * pages come from a memfd mapped at both halves of a reserved range, so they
+ * only cost memory once. The size must be a multiple of the page size.
+ */
+class MirroredStorage {
+  public:
+    /// Tells RingBump that records may run past the end of the buffer.
+    static constexpr bool mirrored = true;
+
+    /**
+     * @brief Maps a buffer of the given size, and its mirror right after it.
+     * @param size Number of bytes in the buffer, a multiple of the page size.
+     * @throws std::invalid_argument if the size is not a multiple of the page
+     * size.
+     * @throws std::bad_alloc if any of the mappings fails.
+     */
+    explicit MirroredStorage(size_t size) : size(size) {
+        static const size_t page = sysconf(_SC_PAGESIZE);
+        if (size == 0 || size % page != 0)
+            throw std::invalid_argument(
+                "MirroredStorage size must be a multiple of the page size");
+
+        int fd = memfd_create("mirrored_storage", MFD_CLOEXEC);
+        if (fd < 0)
+            throw std::bad_alloc();
+
+        // Reserve both halves first, then map the file over each of them
+        void *range = MAP_FAILED;
+        if (ftruncate(fd, size) == 0)
+            range = mmap(nullptr, 2 * size, PROT_NONE,
+                         MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        start = static_cast<byte *>(range);
+        bool mapped =
+            range != MAP_FAILED &&
+            mmap(start, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED,
+                 fd, 0) != MAP_FAILED &&
+            mmap(start + size, size, PROT_READ | PROT_WRITE,
+                 MAP_SHARED | MAP_FIXED, fd, 0) != MAP_FAILED;
+        close(fd);
+
+        if (!mapped) {
+            if (range != MAP_FAILED)
+                munmap(range, 2 * size);
+            throw std::bad_alloc();
+        }
+    }
+
+    MirroredStorage(const MirroredStorage &) = delete;
+    MirroredStorage &operator=(const MirroredStorage &) = delete;
+
+    /**
+     * @brief Gets the start of the buffer.
+     */
+    byte *data() { return start; }
+
+    /**
+     * @brief Unmaps the buffer and its mirror.
+     */
+    ~MirroredStorage() { munmap(start, 2 * size); }
+
+  private:
+    byte *start; ///< Start of the buffer, followed by its mirror.
+    size_t size; ///< Size of the buffer, without the mirror.
+};
+#endif
+
+/**
+ * @brief Options for Trimming. Derive from it and override any of the values
+ * to configure a policy.
+ */
+struct TrimDefaults {
+    /// Fraction of the estimate lost on every reset, as a shift: 3 is 1/8.
+    static constexpr unsigned decay_shift = 3;
+    /// Headroom kept above the estimate, as a shift: 2 is 1/4 more.
+    static constexpr unsigned headroom_shift = 2;
+    /// Fewest bytes worth an madvise call.
+    static constexpr size_t min_trim = 1 << 20;
+    /// MADV_DONTNEED, or MADV_FREE to let the kernel take pages lazily.
+    static constexpr int advice = MADV_DONTNEED;
+};
+
+/**
+ * @class Trimming
+ * @brief Storage policy that returns pages to the kernel when the allocator
+ * is reset, once its usage stays below what it touched before.
+ * @tparam Storage The storage providing the buffer, usually MmapStorage.
+ * @tparam Options A TrimDefaults, or a struct derived from it.
+ *
+ * Every reset feeds the bytes used since the last one into an estimate of
+ * the working set. The estimate follows a larger use at once and decays
+ * slowly after it, by 1/2^decay_shift per reset. Pages touched beyond the
+ * estimate plus its headroom are released with madvise, provided that is at
+ * least min_trim bytes. A single spike is therefore given back after some
+ * resets, while a use that varies within the headroom never releases pages
+ * that are about to be touched again.
+ *
+ * An allocator growing from both ends, like DoubleEndedBump, reports each end
+ * on its own. The two ends keep separate estimates, and an end never
+ * releases the pages the other one is using.
+ *
+ * The buffer must come from mmap, as from MmapStorage. Memory from operator
+ * new is shared with the rest of the heap, so HeapStorage is rejected.
+ *
+ * After MADV_DONTNEED the pages are gone at once and read as zeros.
+ * MADV_FREE is cheaper, but the kernel only takes the pages under memory
+ * pressure, and until then they still count as resident.
+ */
+template <class Storage = MmapStorage<>, class Options = TrimDefaults>
+class Trimming : public Storage {
+    static_assert(!std::is_same_v<Storage, HeapStorage>,
+                  "Trimming needs memory from mmap: madvise on memory from "
+                  "operator new fails or discards heap pages");
+
+  public:
+    /**
+     * @brief Creates the underlying storage for a buffer of the given size.
+     * @param size Number of bytes in the buffer.
+     */
+    explicit Trimming(size_t size)
+        : Storage(size), size(size), estimates{}, touched_bytes{},
+          num_trims(0) {}
+
+    /**
+     * @brief Called by the allocator when it is reset.
+     * @param used Bytes used since the last reset, counted from the end the
+     * allocator grows from.
+     * @param from_end Whether the allocator grows down from the end of the
+     * buffer, like BumpDown.
+     * @param other Bytes in use from the other end of the buffer, which must
+     * not be released.
+     */
+    void reset(size_t used, bool from_end, size_t other = 0) {
+        size_t &estimate = estimates[from_end];
+        size_t &touched = touched_bytes[from_end];
+        touched = used > touched ? used : touched;
+        size_t decayed = estimate - (estimate >> Options::decay_shift);
+        estimate = used > decayed ? used : decayed;
+
+        // Keep the estimate and its headroom, next to where the allocator
+        // grows from
+        size_t keep = estimate + (estimate >> Options::headroom_shift);
+        if (keep >= touched || touched - keep < Options::min_trim)
+            return;
+
+        // Release the whole pages between keep and touched. The end of the
+        // buffer need not be on a page boundary, so round both addresses.
+        static const uintptr_t page = sysconf(_SC_PAGESIZE);
+        uintptr_t base = reinterpret_cast<uintptr_t>(this->data());
+        uintptr_t first = from_end ? base + size - touched : base + keep;
+        uintptr_t last = from_end ? base + size - keep : base + touched;
+        if (from_end && first < base + other)
+            first = base + other;
+        if (!from_end && last > base + size - other)
+            last = base + size - other;
+        first = (first - 1u + page) & -page;
+        last &= -page;
+        if (first < last && madvise(reinterpret_cast<void *>(first),
+                                    last - first, Options::advice) == 0) {
+            // What is left may still be resident, up to the rounded address
+            touched = from_end ? base + size - last : first - base;
+            num_trims++;
+        }
+    }
+
+    /**
+     * @brief Gets the current working set estimate, of both ends together.
+     * @return The estimate in bytes.
+     */
+    size_t get_estimate() { return estimates[0] + estimates[1]; }
+
+    /**
+     * @brief Gets the number of times pages were released.
+     * @return The number of trims.
+     */
+    int get_num_trims() { return num_trims; }
+
+  private:
+    size_t size;             ///< Size of the buffer.
+    size_t estimates[2];     ///< Decaying high-water mark, per end.
+    size_t touched_bytes[2]; ///< Bytes maybe resident since a trim, per end.
+    int num_trims;           ///< Number of madvise calls made.
+};
+
+/**
+ * @brief Whether a storage policy has a reset hook, like Trimming.
+ */
+template <class Storage, class = void>
+struct has_reset_hook : std::false_type {};
+
+template <class Storage>
+struct has_reset_hook<Storage, std::void_t<decltype(std::declval<Storage &>()
+                                                        .reset(0, false))>>
+    : std::true_type {};
+
+/**
+ * @brief Tells a storage policy that its allocator was reset, if it wants to
+ * know.
+ * @param storage The allocator's storage.
+ * @param used Bytes used since the last reset, counted from the end the
+ * allocator grows from.
+ * @param from_end Whether the allocator grows down from the end.
+ * @param other Bytes in use from the other end, for allocators growing from
+ * both.
+ */
+template <class Storage>
+void notify_reset(Storage &storage, size_t used, bool from_end,
+                  size_t other = 0) {
+    if constexpr (has_reset_hook<Storage>::value)
+        storage.reset(used, from_end, other);
+}
@@ -0,0 +1,316 @@
+#pragma once
+
+/**
+ * @file tl_balloc.hpp
+ * @brief Defines the ThreadArenas class, which gives every thread its own
+ * bump allocator.
+ */
+
+#include <atomic>  // For std::atomic
+#include <cstddef> // For size_t
+#include <vector>  // For std::vector
+
+using std::byte;
+
+/**
+ * @class ThreadArenas
+ * @brief A registry that hands every thread its own arena, created on first
+ * use and recycled when the thread exits.
+ * @tparam Arena The allocator each thread gets, such as BumpUp or BumpDown.
+ *
+ * Allocating goes to the calling thread's arena, so threads never contend
+ * with each other and the fast path is an ordinary bump. When a thread exits
+ * its arena goes back to a lock-free pool and the next new thread reuses it
+ * instead of creating another one.
+ *
+ * Any thread can free any object. The arena owning it is found by address.
+ * Frees from the owning thread are counted directly. Frees from other threads
+ * only increment an atomic counter on the arena, which the owner collects
+ * later, so a remote free never touches the owner's bump pointer. Once every
+ * object of an arena has been freed, locally or remotely, the owner resets it
+ * with force_dealloc().
+ *
+ * The registry must outlive every thread that used it, apart from the thread
+ * that destroys it.
+ *
+ * ```cpp
+ * ThreadArenas<BumpUp<1 << 20>> arenas;
+ * // on any thread:
+ * Node *n = arenas.alloc<Node>(1);
+ * arenas.dealloc(n); // on this thread or another one
+ * ```
+ */
+template <class Arena> class ThreadArenas {
+  public:
+    /**
+     * @brief Constructor for the ThreadArenas class. No arena is created
+     * until a thread allocates.
+     */
+    ThreadArenas() : free_slots(nullptr), all_slots(nullptr), num_arenas(0) {}
+
+    ThreadArenas(const ThreadArenas &) = delete;
+    ThreadArenas &operator=(const ThreadArenas &) = delete;
+
+    /**
+     * @brief Allocates memory for an array of elements of type T from the
+     * calling thread's arena.
+     *
+     * @tparam T The type of elements to allocate.
+     * @param n Number of elements to allocate space for.
+     * @returns A pointer to the allocated memory, or nullptr if allocation
+     * fails.
+     */
+    template <class T> T *alloc(size_t n) {
+        return reinterpret_cast<T *>(alloc_bytes(sizeof(T) * n, alignof(T)));
+    }
+
+    /**
+     * @brief Allocates raw memory from the calling thread's arena.
+     *
+     * @param size Number of bytes to allocate.
+     * @param alignment Alignment of the returned pointer, must be a power of
+     * two.
+     * @returns A pointer to the allocated memory, or nullptr if allocation
+     * fails.
+     *
+     * If the arena is full but every object in it has been freed by other
+     * threads in the meantime, it is reset and the allocation retried.
+     */
+    byte *alloc_bytes(size_t size, size_t alignment) {
+        Slot *slot = local_slot();
+        byte *p = slot->arena.alloc_bytes(size, alignment);
+        if (!p) {
+            collect_remote(slot);
+            p = slot->arena.alloc_bytes(size, alignment);
+            if (!p)
+                return nullptr;
+        }
+        slot->live++;
+        return p;
+    }
+
+    /**
+     * @brief Frees one object, from any thread.
+     * @param p An object from alloc() or alloc_bytes(), or nullptr.
+     *
+     * A free from the thread owning the object checks only that thread's
+     * arena. A free from another thread has to find the owning arena, in time
+     * linear in the number of arenas, which is the highest number of threads
+     * that used the registry at once.
+     */
+    void dealloc(const void *p) {
+        if (!p)
+            return;
+
+        Slot *local = bound_slot();
+        if (local && local->arena.owns(p)) {
+            local->live--;
+            collect_remote(local);
+            return;
+        }
+
+        Slot *owner = find_slot(p);
+        if (owner)
+            owner->remote_frees.fetch_add(1, std::memory_order_release);
+    }
+
+    /**
+     * @brief Gets the calling thread's arena, creating it if needed.
+     * @return The arena, which only this thread may use directly.
+     */
+    Arena &local() { return local_slot()->arena; }
+
+    /**
+     * @brief Gets the number of arenas created so far, in use or pooled.
+     * @return The number of arenas.
+     */
+    int get_num_arenas() { return num_arenas.load(std::memory_order_relaxed); }
+
+    /**
+     * @brief Destructor for the ThreadArenas class.
+     * Unbinds the calling thread and deletes every arena.
+     */
+    ~ThreadArenas() {
+        bindings().remove(this);
+        Slot *slot = all_slots.load(std::memory_order_acquire);
+        while (slot) {
+            Slot *next = slot->next_created;
+            delete slot;
+            slot = next;
+        }
+    }
+
+  private:
+    /**
+     * @brief An arena and the bookkeeping that travels with it between
+     * threads.
+     */
+    struct Slot {
+        Arena arena;                   ///< The arena itself.
+        int live = 0;                  ///< Live objects known to the owner.
+        std::atomic<int> remote_frees; ///< Frees by other threads.
+        Slot *next_free = nullptr;     ///< Next slot in the pool.
+        Slot *next_created = nullptr;  ///< Next slot ever created.
+
+        Slot() : remote_frees(0) {}
+    };
+
+    /**
+     * @brief The arenas the current thread has taken from each registry.
+     *
+     * A thread usually uses one registry, so this is almost always a single
+     * entry. On thread exit every arena goes back to its registry's pool.
+     */
+    struct Bindings {
+        /**
+         * @brief One registry and the slot the thread holds from it.
+         */
+        struct Binding {
+            ThreadArenas *registry; ///< Registry the slot belongs to.
+            Slot *slot;             ///< Slot held by this thread.
+        };
+
+        std::vector<Binding> held;         ///< Slots held by this thread.
+        Binding last = {nullptr, nullptr}; ///< Most recent lookup.
+
+        /**
+         * @brief Gets the slot held from a registry, or nullptr.
+         */
+        Slot *find(ThreadArenas *registry) {
+            if (last.registry == registry)
+                return last.slot;
+            for (Binding &b : held) {
+                if (b.registry == registry) {
+                    last = b;
+                    return b.slot;
+                }
+            }
+            return nullptr;
+        }
+
+        /**
+         * @brief Forgets a registry without returning its slot.
+         */
+        void remove(ThreadArenas *registry) {
+            last = {nullptr, nullptr};
+            for (size_t i = 0; i < held.size(); i++) {
+                if (held[i].registry == registry) {
+                    held.erase(held.begin() + i);
+                    return;
+                }
+            }
+        }
+
+        /**
+         * @brief Returns every held slot to its pool when the thread exits.
+         */
+        ~Bindings() {
+            for (Binding &b : held)
+                b.registry->release(b.slot);
+        }
+    };
+
+    /**
+     * @brief Gets the current thread's bindings.
+     */
+    static Bindings &bindings() {
+        thread_local Bindings current;
+        return current;
+    }
+
+    /**
+     * @brief Gets the slot the current thread holds, or nullptr.
+     */
+    Slot *bound_slot() { return bindings().find(this); }
+
+    /**
+     * @brief Gets the current thread's slot, taking one if it has none.
+     */
+    Slot *local_slot() {
+        if (Slot *slot = bound_slot())
+            return slot;
+
+        Slot *slot = acquire();
+        bindings().held.push_back({this, slot});
+        return slot;
+    }
+
+    /**
+     * @brief Takes a slot from the pool, or creates one.
+     *
+     * The pool is a Treiber stack. Popping a single node with a
+     * compare-and-swap is exposed to ABA: another thread could pop the node,
+     * and push it back with a different successor, between our load and our
+     * swap. Instead the whole stack is taken with one exchange, the first
+     * node kept, and the rest pushed back as a chain. A thread that finds the
+     * pool empty in the meantime simply creates a new slot.
+     */
+    Slot *acquire() {
+        Slot *head = free_slots.exchange(nullptr, std::memory_order_acquire);
+        if (!head) {
+            Slot *slot = new Slot();
+            slot->next_created = all_slots.load(std::memory_order_relaxed);
+            while (!all_slots.compare_exchange_weak(
+                slot->next_created, slot, std::memory_order_release,
+                std::memory_order_relaxed)) {
+            }
+            num_arenas.fetch_add(1, std::memory_order_relaxed);
+            return slot;
+        }
+
+        Slot *rest = head->next_free;
+        if (rest) {
+            Slot *tail = rest;
+            while (tail->next_free)
+                tail = tail->next_free;
+            push_chain(rest, tail);
+        }
+        head->next_free = nullptr;
+        return head;
+    }
+
+    /**
+     * @brief Returns a slot to the pool when its thread exits.
+     */
+    void release(Slot *slot) {
+        collect_remote(slot);
+        push_chain(slot, slot);
+    }
+
+    /**
+     * @brief Pushes a linked chain of slots onto the pool.
+     */
+    void push_chain(Slot *first, Slot *last) {
+        last->next_free = free_slots.load(std::memory_order_relaxed);
+        while (!free_slots.compare_exchange_weak(last->next_free, first,
+                                                 std::memory_order_release,
+                                                 std::memory_order_relaxed)) {
+        }
+    }
+
+    /**
+     * @brief Counts frees made by other threads, and resets the arena once
+     * nothing in it is alive. Only called by the slot's owner.
+     */
+    void collect_remote(Slot *slot) {
+        if (slot->remote_frees.load(std::memory_order_relaxed))
+            slot->live -=
+                slot->remote_frees.exchange(0, std::memory_order_acquire);
+        if (slot->live == 0)
+            slot->arena.force_dealloc();
+    }
+
+    /**
+     * @brief Finds the slot whose arena owns p.
+     */
+    Slot *find_slot(const void *p) {
+        Slot *slot = all_slots.load(std::memory_order_acquire);
+        while (slot && !slot->arena.owns(p))
+            slot = slot->next_created;
+        return slot;
+    }
+
+    std::atomic<Slot *> free_slots; ///< Pool of slots of exited threads.
+    std::atomic<Slot *> all_slots;  ///< Every slot, newest first.
+    std::atomic<int> num_arenas;    ///< Number of slots created.
+};
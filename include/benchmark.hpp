@@ -1,13 +1,240 @@
 #pragma once
 
+#include <algorithm>
 #include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <fstream>
 #include <iomanip>
 #include <iostream>
 #include <numeric>
+#include <sstream>
+#include <string>
+#include <tuple>
+#include <type_traits>
 #include <vector>
 
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define BENCHMARK_HAS_RDTSC 1
+#endif
+
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#define BENCHMARK_HAS_PERF 1
+#endif
+
+// The build can record its flags in exported results with
+// -DBENCHMARK_FLAGS="\"-O3 -march=native\""
+#ifndef BENCHMARK_FLAGS
+#define BENCHMARK_FLAGS "unknown"
+#endif
+
+/**
+ * @brief Makes the compiler assume a value is read and may have been changed.
+ *
+ * Results passed here cannot be optimized away, and values passed here cannot
+ * be constant folded into the code that uses them afterwards.
+ * @param value The value to hide from the optimizer.
+ */
+template <class T> inline void do_not_optimize(T &value) {
+#if defined(__GNUC__)
+    asm volatile("" : "+m"(value) : : "memory");
+#else
+    static volatile const void *escape;
+    escape = &value;
+#endif
+}
+
+/**
+ * @brief Overload for temporaries, such as the return value of a call.
+ */
+template <class T> inline void do_not_optimize(const T &value) {
+#if defined(__GNUC__)
+    asm volatile("" : : "m"(value) : "memory");
+#else
+    static volatile const void *escape;
+    escape = &value;
+#endif
+}
+
+/**
+ * @brief Makes the compiler assume all memory may have been read and written,
+ * so pending stores have to happen before this point.
+ */
+inline void clobber_memory() {
+#if defined(__GNUC__)
+    asm volatile("" : : : "memory");
+#endif
+}
+
+/**
+ * @brief Event counters read through Linux perf_event_open.
+ *
+ * Every event is opened on its own, so an event the machine or kernel does
+ * not offer is just missing instead of taking the others down with it. In a
+ * VM or container, or with a strict perf_event_paranoid, usually only the
+ * software events open, or none at all. Only user space is counted, which
+ * paranoid level 2 still allows.
+ */
+class PerfCounters {
+  public:
+    /**
+     * @brief The events that are counted.
+     */
+    enum Event {
+        CYCLES,
+        INSTRUCTIONS,
+        BRANCH_MISSES,
+        L1D_MISSES,
+        LLC_MISSES,
+        DTLB_MISSES,
+        PAGE_FAULTS,
+        NUM_EVENTS
+    };
+
+    /**
+     * @brief Opens the counters, or none if enable is false.
+     */
+    explicit PerfCounters(bool enable) {
+        for (int e = 0; e < NUM_EVENTS; e++)
+            fds[e] = enable ? open(Event(e)) : -1;
+    }
+
+    PerfCounters(const PerfCounters &) = delete;
+    PerfCounters &operator=(const PerfCounters &) = delete;
+
+    /**
+     * @brief Destructor for PerfCounters, closes the counters.
+     */
+    ~PerfCounters() {
+#ifdef BENCHMARK_HAS_PERF
+        for (int fd : fds)
+            if (fd >= 0)
+                close(fd);
+#endif
+    }
+
+    /**
+     * @brief Checks whether an event could be opened.
+     */
+    bool available(Event e) { return fds[e] >= 0; }
+
+    /**
+     * @brief Zeroes and starts every open counter.
+     */
+    void start() {
+#ifdef BENCHMARK_HAS_PERF
+        for (int fd : fds) {
+            if (fd >= 0) {
+                ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+                ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+            }
+        }
+#endif
+    }
+
+    /**
+     * @brief Stops every open counter.
+     */
+    void stop() {
+#ifdef BENCHMARK_HAS_PERF
+        for (int fd : fds)
+            if (fd >= 0)
+                ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+#endif
+    }
+
+    /**
+     * @brief Reads an event's count since start(), or 0 if it is not open.
+     */
+    uint64_t read(Event e) {
+        uint64_t count = 0;
+#ifdef BENCHMARK_HAS_PERF
+        if (fds[e] >= 0 &&
+            ::read(fds[e], &count, sizeof(count)) != sizeof(count))
+            count = 0;
+#endif
+        return count;
+    }
+
+    /**
+     * @brief Gets the column heading of an event.
+     */
+    static const char *name(Event e) {
+        static const char *names[NUM_EVENTS] = {
+            "HW cycles", "Instructions", "Branch miss", "L1D miss",
+            "LLC miss",  "dTLB miss",    "Page faults"};
+        return names[e];
+    }
+
+  private:
+    int fds[NUM_EVENTS]; /**< Counter file descriptors, -1 if not open. */
+
+    /**
+     * @brief Opens one event for the calling thread, or returns -1.
+     */
+    static int open(Event e) {
+#ifdef BENCHMARK_HAS_PERF
+        perf_event_attr attr{};
+        attr.size = sizeof(attr);
+        attr.disabled = 1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+
+        // Cache events are encoded as cache | operation << 8 | result << 16
+        const uint64_t read_miss = PERF_COUNT_HW_CACHE_OP_READ << 8 |
+                                   PERF_COUNT_HW_CACHE_RESULT_MISS << 16;
+        switch (e) {
+        case CYCLES:
+            attr.type = PERF_TYPE_HARDWARE;
+            attr.config = PERF_COUNT_HW_CPU_CYCLES;
+            break;
+        case INSTRUCTIONS:
+            attr.type = PERF_TYPE_HARDWARE;
+            attr.config = PERF_COUNT_HW_INSTRUCTIONS;
+            break;
+        case BRANCH_MISSES:
+            attr.type = PERF_TYPE_HARDWARE;
+            attr.config = PERF_COUNT_HW_BRANCH_MISSES;
+            break;
+        case L1D_MISSES:
+            attr.type = PERF_TYPE_HW_CACHE;
+            attr.config = PERF_COUNT_HW_CACHE_L1D | read_miss;
+            break;
+        case LLC_MISSES:
+            attr.type = PERF_TYPE_HW_CACHE;
+            attr.config = PERF_COUNT_HW_CACHE_LL | read_miss;
+            break;
+        case DTLB_MISSES:
+            attr.type = PERF_TYPE_HW_CACHE;
+            attr.config = PERF_COUNT_HW_CACHE_DTLB | read_miss;
+            break;
+        case PAGE_FAULTS:
+            attr.type = PERF_TYPE_SOFTWARE;
+            attr.config = PERF_COUNT_SW_PAGE_FAULTS;
+            break;
+        default:
+            return -1;
+        }
+        return syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+#else
+        (void)e;
+        return -1;
+#endif
+    }
+};
+
 /**
  * @brief A simple benchmarking class for measuring the runtime of functions.
+ *
+ * Every iteration records one sample. A sample times a batch of calls and
+ * divides by the batch size, which keeps timer overhead out of nanosecond
+ * scale measurements. Warmup iterations run first and are not recorded.
+ * Optionally, perf event counters are read around every sample as well.
  */
 class Benchmark {
   public:
@@ -17,6 +244,10 @@ class Benchmark {
     Benchmark() {
         num_benchmars = 0;
         num_iterations = 1;
+        num_warmup = 0;
+        batch_size = 1;
+        count_cycles = false;
+        count_events = false;
     }
 
     /**
@@ -26,6 +257,58 @@ class Benchmark {
     Benchmark(int iters) {
         num_benchmars = 0;
         num_iterations = iters;
+        num_warmup = 0;
+        batch_size = 1;
+        count_cycles = false;
+        count_events = false;
+    }
+
+    /**
+     * @brief Sets the number of untimed iterations run before measuring.
+     * @param iters The number of warmup iterations.
+     * @return This benchmark, for chaining.
+     */
+    Benchmark &warmup(int iters) {
+        num_warmup = iters;
+        return *this;
+    }
+
+    /**
+     * @brief Sets the number of calls timed together in one sample.
+     * @param calls The number of calls per sample.
+     * @return This benchmark, for chaining.
+     */
+    Benchmark &batch(int calls) {
+        batch_size = calls;
+        return *this;
+    }
+
+    /**
+     * @brief Also counts CPU cycles with rdtsc/rdtscp where available.
+     * @param enable Whether to count cycles.
+     * @return This benchmark, for chaining.
+     */
+    Benchmark &cycles(bool enable = true) {
+#ifdef BENCHMARK_HAS_RDTSC
+        count_cycles = enable;
+#else
+        (void)enable;
+#endif
+        return *this;
+    }
+
+    /**
+     * @brief Also reads perf event counters around every sample, and prints
+     * them per call in a second table.
+     *
+     * Events that cannot be opened are shown as n/a, and the timings are
+     * recorded either way.
+     * @param enable Whether to read the counters.
+     * @return This benchmark, for chaining.
+     */
+    Benchmark &counters(bool enable = true) {
+        count_events = enable;
+        return *this;
     }
 
     /**
@@ -35,29 +318,87 @@ class Benchmark {
      * @param name A descriptive name for the benchmark.
      * @param func The function to be benchmarked.
      * @param args The arguments to be passed to the function.
+     *
+     * The arguments are hidden from the optimizer before every call, and the
+     * return value, if any, is kept alive, so neither can be folded away.
      */
     template <typename Func, typename... Args>
     void benchmark(const char *name, Func func, Args &&...args) {
+        benchmark_fixture(
+            name, [] {}, func, [] {}, std::forward<Args>(args)...);
+    }
+
+    /**
+     * @brief Measures a function with setup and teardown steps around every
+     * sample, which are not timed.
+     * @tparam Setup The type of the setup function.
+     * @tparam Func The type of the function to be benchmarked.
+     * @tparam Teardown The type of the teardown function.
+     * @tparam Args The types of arguments for the function.
+     * @param name A descriptive name for the benchmark.
+     * @param setup Called before each sample.
+     * @param func The function to be benchmarked.
+     * @param teardown Called after each sample.
+     * @param args The arguments to be passed to the function.
+     *
+     * Arguments given as lvalues are passed by reference, so func works on
+     * the caller's objects and nothing is copied. Temporaries are moved into
+     * the benchmark and live until it ends.
+     */
+    template <typename Setup, typename Func, typename Teardown,
+              typename... Args>
+    void benchmark_fixture(const char *name, Setup setup, Func func,
+                           Teardown teardown, Args &&...args) {
         using namespace std::chrono;
 
+        std::tuple<Args...> arguments(std::forward<Args>(args)...);
+
         std::vector<double> elapsed_times;
+        std::vector<double> elapsed_cycles;
         elapsed_times.reserve(num_iterations);
 
-        for (int i = 0; i < num_iterations; ++i) {
+        PerfCounters perf(count_events);
+        double event_totals[PerfCounters::NUM_EVENTS] = {};
+
+        for (int i = -num_warmup; i < num_iterations; ++i) {
+            setup();
+
+            if (count_events)
+                perf.start();
+            uint64_t c1 = count_cycles ? start_cycles() : 0;
             time_point t1 = high_resolution_clock::now();
-            func(std::forward<Args>(args)...);
+            for (int call = 0; call < batch_size; ++call) {
+                do_not_optimize(arguments);
+                invoke(func, arguments);
+            }
+            clobber_memory();
             time_point t2 = high_resolution_clock::now();
+            uint64_t c2 = count_cycles ? stop_cycles() : 0;
+            if (count_events)
+                perf.stop();
+
+            teardown();
+
+            if (i < 0)
+                continue;
 
             duration<double, std::milli> ms_double = t2 - t1;
-            elapsed_times.push_back(ms_double.count());
+            elapsed_times.push_back(ms_double.count() / batch_size);
+            if (count_cycles)
+                elapsed_cycles.push_back(double(c2 - c1) / batch_size);
+            for (int e = 0; e < PerfCounters::NUM_EVENTS; e++)
+                event_totals[e] += perf.read(PerfCounters::Event(e));
         }
 
-        double result =
-            std::accumulate(elapsed_times.begin(), elapsed_times.end(), 0.0) /
-            num_iterations;
+        Result r = summarize(elapsed_times, elapsed_cycles);
+        double calls = double(num_iterations) * batch_size;
+        for (int e = 0; e < PerfCounters::NUM_EVENTS; e++)
+            r.events[e] = perf.available(PerfCounters::Event(e))
+                              ? event_totals[e] / calls
+                              : -1;
 
         names.push_back(name);
-        results.push_back(result);
+        results.push_back(r);
         num_benchmars++;
     }
 
@@ -72,25 +413,188 @@ class Benchmark {
         const int column_width = 15;
 
         std::cout << std::left << std::setw(column_width) << "Name"
-                  << std::setw(column_width) << "Result (ms)"
-                  << "Relative (%)" << std::endl;
+                  << std::setw(column_width) << "Mean (ms)"
+                  << std::setw(column_width) << "Median (ms)"
+                  << std::setw(column_width) << "p90 (ms)"
+                  << std::setw(column_width) << "p99 (ms)"
+                  << std::setw(column_width) << "Min (ms)"
+                  << std::setw(column_width) << "Stddev (ms)";
+        if (count_cycles)
+            std::cout << std::setw(column_width) << "Cycles";
+        std::cout << "Relative (%)" << std::endl;
 
         // Print each row in the table
         for (int i = 0; i < num_benchmars; i++) {
+            const Result &r = results[i];
             std::cout << std::left << std::setw(column_width) << names[i]
-                      << std::fixed << std::setw(column_width)
-                      << std::setprecision(8) << results[i]
-                      << std::setprecision(8) << relative(results[i])
+                      << std::fixed << std::setprecision(8)
+                      << std::setw(column_width) << r.mean
+                      << std::setw(column_width) << r.median
+                      << std::setw(column_width) << r.p90
+                      << std::setw(column_width) << r.p99
+                      << std::setw(column_width) << r.min
+                      << std::setw(column_width) << r.stddev;
+            if (count_cycles)
+                std::cout << std::setprecision(1) << std::setw(column_width)
+                          << r.cycles;
+            std::cout << std::setprecision(8) << relative(r.mean)
                       << std::endl;
         }
         std::cout << std::endl;
+
+        if (count_events)
+            print_events();
     }
 
+    /**
+     * @brief Gets the mean runtime of a benchmark that has been run.
+     * @param index Position of the benchmark, in the order they were run.
+     * @return The mean time per call in milliseconds.
+     */
+    double get_mean(int index) { return results[index].mean; }
+
   private:
+    friend class BenchmarkReport;
+
+    /**
+     * @brief Summary statistics of one benchmark, in milliseconds per call.
+     */
+    struct Result {
+        double mean;   /**< Arithmetic mean. */
+        double median; /**< 50th percentile. */
+        double p90;    /**< 90th percentile. */
+        double p99;    /**< 99th percentile. */
+        double min;    /**< Fastest sample. */
+        double stddev; /**< Sample standard deviation. */
+        double cycles; /**< Median cycles per call, if counted. */
+        int samples;   /**< Number of recorded samples. */
+        /** Perf event counts per call, -1 for events that are not open. */
+        double events[PerfCounters::NUM_EVENTS];
+    };
+
     int num_benchmars;  /**< Number of benchmarks performed. */
     int num_iterations; /**< Number of iterations for each benchmark. */
+    int num_warmup;     /**< Untimed iterations before measuring. */
+    int batch_size;     /**< Calls timed together in one sample. */
+    bool count_cycles;  /**< Whether to count cycles with rdtsc. */
+    bool count_events;  /**< Whether to read perf event counters. */
     std::vector<const char *> names; /**< Names of benchmarks. */
-    std::vector<double> results;     /**< Results of benchmarks. */
+    std::vector<Result> results;     /**< Results of benchmarks. */
+
+    /**
+     * @brief Calls func with the stored arguments, keeping any result alive.
+     */
+    template <typename Func, typename Tuple>
+    static void invoke(Func &func, Tuple &arguments) {
+        using Return = decltype(std::apply(func, arguments));
+        if constexpr (std::is_void_v<Return>) {
+            std::apply(func, arguments);
+        } else {
+            do_not_optimize(std::apply(func, arguments));
+        }
+    }
+
+    /**
+     * @brief Prints the perf event counts per call of every benchmark.
+     */
+    void print_events() {
+        const int column_width = 15;
+
+        bool any = false;
+        std::cout << std::left << std::setw(column_width) << "Name";
+        for (int e = 0; e < PerfCounters::NUM_EVENTS; e++)
+            std::cout << std::setw(column_width)
+                      << PerfCounters::name(PerfCounters::Event(e));
+        std::cout << std::endl;
+
+        for (int i = 0; i < num_benchmars; i++) {
+            std::cout << std::left << std::setw(column_width) << names[i]
+                      << std::fixed << std::setprecision(2);
+            for (double count : results[i].events) {
+                if (count < 0) {
+                    std::cout << std::setw(column_width) << "n/a";
+                } else {
+                    std::cout << std::setw(column_width) << count;
+                    any = true;
+                }
+            }
+            std::cout << std::endl;
+        }
+
+        if (!any)
+            std::cout << "perf counters unavailable, check "
+                         "/proc/sys/kernel/perf_event_paranoid"
+                      << std::endl;
+        std::cout << std::endl;
+    }
+
+    /**
+     * @brief Reads the cycle counter before the measured code.
+     */
+    static uint64_t start_cycles() {
+#ifdef BENCHMARK_HAS_RDTSC
+        // lfence keeps earlier instructions from leaking into the window
+        _mm_lfence();
+        uint64_t c = __rdtsc();
+        _mm_lfence();
+        return c;
+#else
+        return 0;
+#endif
+    }
+
+    /**
+     * @brief Reads the cycle counter after the measured code.
+     */
+    static uint64_t stop_cycles() {
+#ifdef BENCHMARK_HAS_RDTSC
+        // rdtscp waits for the measured instructions to retire
+        unsigned aux;
+        uint64_t c = __rdtscp(&aux);
+        _mm_lfence();
+        return c;
+#else
+        return 0;
+#endif
+    }
+
+    /**
+     * @brief Gets the nearest-rank percentile of sorted samples.
+     */
+    static double percentile(const std::vector<double> &sorted, double p) {
+        size_t rank = (size_t)std::ceil(p * sorted.size());
+        return sorted[rank ? rank - 1 : 0];
+    }
+
+    /**
+     * @brief Computes the summary statistics of a benchmark's samples.
+     */
+    static Result summarize(std::vector<double> times,
+                            std::vector<double> cycles) {
+        Result r{};
+        if (times.empty())
+            return r;
+
+        std::sort(times.begin(), times.end());
+        size_t n = times.size();
+        r.samples = n;
+        r.mean = std::accumulate(times.begin(), times.end(), 0.0) / n;
+        r.median = percentile(times, 0.5);
+        r.p90 = percentile(times, 0.9);
+        r.p99 = percentile(times, 0.99);
+        r.min = times.front();
+
+        double squares = 0;
+        for (double t : times)
+            squares += (t - r.mean) * (t - r.mean);
+        r.stddev = n > 1 ? std::sqrt(squares / (n - 1)) : 0.0;
+
+        if (!cycles.empty()) {
+            std::sort(cycles.begin(), cycles.end());
+            r.cycles = percentile(cycles, 0.5);
+        }
+        return r;
+    }
 
     /**
      * @brief Calculates the relative percentage difference from the first
@@ -99,6 +603,278 @@ class Benchmark {
      * @return The relative percentage difference.
      */
     inline double relative(double runtime) {
-        return 100 * (results[0] - runtime) / results[0];
+        return 100 * (results[0].mean - runtime) / results[0].mean;
+    }
+};
+
+/**
+ * @brief The machine and build a set of results was recorded with.
+ */
+struct BenchmarkEnvironment {
+    std::string cpu;      /**< CPU model name. */
+    std::string compiler; /**< Compiler version string. */
+    std::string flags;    /**< Compiler flags, from BENCHMARK_FLAGS. */
+
+    /**
+     * @brief Describes the running machine and this build.
+     */
+    static BenchmarkEnvironment current() {
+        BenchmarkEnvironment env{"unknown", "unknown", BENCHMARK_FLAGS};
+
+        std::ifstream cpuinfo("/proc/cpuinfo");
+        std::string line;
+        while (std::getline(cpuinfo, line)) {
+            if (line.compare(0, 10, "model name") == 0) {
+                size_t colon = line.find(':');
+                if (colon != std::string::npos && colon + 2 <= line.size())
+                    env.cpu = line.substr(colon + 2);
+                break;
+            }
+        }
+
+#if defined(__VERSION__)
+#if defined(__clang__)
+        env.compiler = "clang " __VERSION__;
+#elif defined(__GNUC__)
+        env.compiler = "gcc " __VERSION__;
+#else
+        env.compiler = __VERSION__;
+#endif
+#endif
+        return env;
+    }
+};
+
+/**
+ * @brief Collects the results of several Benchmark runs, exports them as CSV
+ * or JSON, and compares them against a saved baseline.
+ *
+ * Results are identified by benchmark name, so names should be unique across
+ * everything added to one report.
+ */
+class BenchmarkReport {
+  public:
+    /**
+     * @brief Constructs an empty report for the running machine.
+     */
+    BenchmarkReport() : environment(BenchmarkEnvironment::current()) {}
+
+    /**
+     * @brief Copies the results of every benchmark in b into the report.
+     */
+    void add(const Benchmark &b) {
+        for (int i = 0; i < b.num_benchmars; i++)
+            rows.push_back({b.names[i], b.results[i]});
+    }
+
+    /**
+     * @brief Writes the report as CSV, with the environment in comment lines.
+     * @param out The stream to write to.
+     */
+    void write_csv(std::ostream &out) {
+        out << "# cpu: " << environment.cpu << "\n"
+            << "# compiler: " << environment.compiler << "\n"
+            << "# flags: " << environment.flags << "\n"
+            << "name,mean_ms,median_ms,p90_ms,p99_ms,min_ms,stddev_ms,"
+               "cycles,samples\n";
+        out << std::setprecision(10);
+        for (const Row &row : rows) {
+            const Benchmark::Result &r = row.result;
+            out << '"' << row.name << "\"," << r.mean << ',' << r.median
+                << ',' << r.p90 << ',' << r.p99 << ',' << r.min << ','
+                << r.stddev << ',' << r.cycles << ',' << r.samples << "\n";
+        }
+    }
+
+    /**
+     * @brief Writes the report as a JSON document.
+     * @param out The stream to write to.
+     */
+    void write_json(std::ostream &out) {
+        out << std::setprecision(10) << "{\n  \"environment\": {\n"
+            << "    \"cpu\": " << quote(environment.cpu) << ",\n"
+            << "    \"compiler\": " << quote(environment.compiler) << ",\n"
+            << "    \"flags\": " << quote(environment.flags) << "\n  },\n"
+            << "  \"benchmarks\": [";
+        for (size_t i = 0; i < rows.size(); i++) {
+            const Benchmark::Result &r = rows[i].result;
+            out << (i ? ",\n" : "\n") << "    {\"name\": "
+                << quote(rows[i].name) << ", \"mean_ms\": " << r.mean
+                << ", \"median_ms\": " << r.median << ", \"p90_ms\": " << r.p90
+                << ", \"p99_ms\": " << r.p99 << ", \"min_ms\": " << r.min
+                << ", \"stddev_ms\": " << r.stddev << ", \"cycles\": "
+                << r.cycles << ", \"samples\": " << r.samples << "}";
+        }
+        out << "\n  ]\n}\n";
+    }
+
+    /**
+     * @brief Compares the report against a baseline written by write_csv().
+     *
+     * A benchmark regresses when its mean is more than tolerance slower than
+     * the baseline's and a one-sided Welch t-test finds the slowdown
+     * significant at the 1% level. Both are required: the test alone flags
+     * tiny differences once there are enough samples, and the tolerance alone
+     * flags noise.
+     * @param baseline The stream holding the baseline CSV.
+     * @param tolerance Allowed relative slowdown, e.g. 0.05 for 5%.
+     * @return The number of regressions found.
+     */
+    int compare(std::istream &baseline, double tolerance) {
+        BenchmarkEnvironment recorded{"unknown", "unknown", "unknown"};
+        std::vector<Row> old_rows = read_csv(baseline, recorded);
+
+        if (recorded.cpu != environment.cpu)
+            std::cout << "warning: baseline was recorded on " << recorded.cpu
+                      << std::endl;
+        if (recorded.compiler != environment.compiler ||
+            recorded.flags != environment.flags)
+            std::cout << "warning: baseline was built with "
+                      << recorded.compiler << " " << recorded.flags
+                      << std::endl;
+
+        const int column_width = 15;
+        std::cout << std::left << std::setw(column_width) << "Name"
+                  << std::setw(column_width) << "Baseline (ms)"
+                  << std::setw(column_width) << "Current (ms)"
+                  << std::setw(column_width) << "Change (%)"
+                  << std::setw(column_width) << "t" << "Status" << std::endl;
+
+        int regressions = 0;
+        for (const Row &row : rows) {
+            const Benchmark::Result &now = row.result;
+            const Row *old = find(old_rows, row.name);
+            std::cout << std::left << std::setw(column_width) << row.name
+                      << std::fixed << std::setprecision(8);
+            if (!old) {
+                std::cout << std::setw(column_width) << "-"
+                          << std::setw(column_width) << now.mean << "new"
+                          << std::endl;
+                continue;
+            }
+
+            const Benchmark::Result &then = old->result;
+            double change = 100 * (now.mean - then.mean) / then.mean;
+            double t = welch_t(then, now);
+            const char *status = "ok";
+            if (now.mean > then.mean * (1 + tolerance) &&
+                t > critical_t(then, now)) {
+                status = "REGRESSION";
+                regressions++;
+            } else if (now.mean < then.mean * (1 - tolerance) &&
+                       -t > critical_t(then, now)) {
+                status = "faster";
+            }
+
+            std::cout << std::setw(column_width) << then.mean
+                      << std::setw(column_width) << now.mean
+                      << std::setprecision(2) << std::setw(column_width)
+                      << change << std::setw(column_width) << t << status
+                      << std::endl;
+        }
+        std::cout << std::endl;
+        return regressions;
+    }
+
+  private:
+    /**
+     * @brief One named result.
+     */
+    struct Row {
+        std::string name;         /**< Benchmark name. */
+        Benchmark::Result result; /**< Its summary statistics. */
+    };
+
+    BenchmarkEnvironment environment; /**< Where these results were taken. */
+    std::vector<Row> rows;            /**< Results, in the order added. */
+
+    /**
+     * @brief Quotes and escapes a string for JSON.
+     */
+    static std::string quote(const std::string &text) {
+        std::string quoted = "\"";
+        for (char c : text) {
+            if (c == '"' || c == '\\')
+                quoted += '\\';
+            quoted += c;
+        }
+        return quoted + "\"";
+    }
+
+    /**
+     * @brief Parses rows and environment written by write_csv().
+     */
+    static std::vector<Row> read_csv(std::istream &in,
+                                     BenchmarkEnvironment &recorded) {
+        std::vector<Row> parsed;
+        std::string line;
+        while (std::getline(in, line)) {
+            if (line.compare(0, 7, "# cpu: ") == 0) {
+                recorded.cpu = line.substr(7);
+            } else if (line.compare(0, 12, "# compiler: ") == 0) {
+                recorded.compiler = line.substr(12);
+            } else if (line.compare(0, 9, "# flags: ") == 0) {
+                recorded.flags = line.substr(9);
+            } else if (!line.empty() && line[0] == '"') {
+                size_t close = line.find('"', 1);
+                if (close == std::string::npos)
+                    continue;
+
+                Row row{line.substr(1, close - 1), {}};
+                Benchmark::Result &r = row.result;
+                std::istringstream fields(line.substr(close + 2));
+                char comma;
+                fields >> r.mean >> comma >> r.median >> comma >> r.p90 >>
+                    comma >> r.p99 >> comma >> r.min >> comma >> r.stddev >>
+                    comma >> r.cycles >> comma >> r.samples;
+                if (fields)
+                    parsed.push_back(row);
+            }
+        }
+        return parsed;
+    }
+
+    /**
+     * @brief Finds a row by name, or returns nullptr.
+     */
+    static const Row *find(const std::vector<Row> &in,
+                           const std::string &name) {
+        for (const Row &row : in)
+            if (row.name == name)
+                return &row;
+        return nullptr;
+    }
+
+    /**
+     * @brief Gets Welch's t statistic for b being slower than a.
+     */
+    static double welch_t(const Benchmark::Result &a,
+                          const Benchmark::Result &b) {
+        double error = a.stddev * a.stddev / a.samples +
+                       b.stddev * b.stddev / b.samples;
+        if (error <= 0)
+            return b.mean > a.mean ? INFINITY : b.mean < a.mean ? -INFINITY : 0;
+        return (b.mean - a.mean) / std::sqrt(error);
+    }
+
+    /**
+     * @brief Gets the one-sided 1% critical value of t, for the
+     * Welch-Satterthwaite degrees of freedom of a and b.
+     */
+    static double critical_t(const Benchmark::Result &a,
+                             const Benchmark::Result &b) {
+        double va = a.stddev * a.stddev / a.samples;
+        double vb = b.stddev * b.stddev / b.samples;
+        double df = (va + vb) * (va + vb);
+        double denominator = 0;
+        if (a.samples > 1)
+            denominator += va * va / (a.samples - 1);
+        if (b.samples > 1)
+            denominator += vb * vb / (b.samples - 1);
+        df = denominator > 0 ? df / denominator : 1e9;
+
+        // Normal quantile with the first-order correction for Student's t
+        const double z = 2.326;
+        return z + (z * z * z + z) / (4 * df);
     }
 };
@@ -1,10 +1,35 @@
+#include <allocators/arena.hpp>
 #include <allocators/balloc.hpp>
+#include <allocators/c_balloc.hpp>
+#include <allocators/chain_balloc.hpp>
+#include <allocators/const_balloc.hpp>
+#include <allocators/de_balloc.hpp>
+#include <allocators/frame_balloc.hpp>
+#include <allocators/numa.hpp>
+#include <allocators/pmr_balloc.hpp>
+#include <allocators/pool.hpp>
 #include <allocators/r_balloc.hpp>
+#include <allocators/ring_balloc.hpp>
+#include <allocators/scope.hpp>
+#include <allocators/snapshot.hpp>
+#include <allocators/soa.hpp>
+#include <allocators/stats.hpp>
+#include <allocators/tl_balloc.hpp>
 
+#include <atomic>
 #include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
 #include <iostream>
 #include <ostream>
 #include <simpletest/simpletest.h>
+#include <string>
+#include <sys/mman.h>
+#include <thread>
+#include <unistd.h>
+#include <unordered_map>
+#include <vector>
 
 #define is_aligned(POINTER, BYTE_COUNT)                                        \
     (((unsigned long)(const void *)(POINTER)) % (BYTE_COUNT) == 0)
@@ -32,7 +57,14 @@ union MyUnion {
 // Define an enum for testing
 enum class MyEnum { VALUE1, VALUE2, VALUE3 };
 
-char const *groups[] = {"BumpUp", "BumpDown"};
+char const *groups[] = {"BumpUp",       "BumpDown",   "ConcurrentBumpUp",
+                         "BumpChain",    "BumpResource", "MmapStorage",
+                         "Arena",        "BumpScope",    "Make",
+                         "Realloc",      "Aligned",      "Stats",
+                         "Pool",         "DoubleEnded",  "ThreadArenas",
+                         "Batch",        "ConstArena",   "Soa",
+                         "FrameRing",    "RingBump",     "Trimming",
+                         "Numa",         "Snapshot"};
 
 DEFINE_TEST_G(Test1, BumpDown) {
     // Test 1: Allocate memory successfully
@@ -373,6 +405,1389 @@ DEFINE_TEST_G(Test8, BumpUp) {
     TEST_MESSAGE(b.alloc<char>(1) == nullptr, "should have failed to allocate");
 }
 
+DEFINE_TEST_G(Test1, ConcurrentBumpUp) {
+    ConcurrentBumpUp<20 * sizeof(int)> bumper;
+    TEST_MESSAGE(bumper.alloc<int>(10) != nullptr, "Failed to allocate!!!!");
+    TEST_MESSAGE(bumper.alloc<int>(10) != nullptr, "Failed to allocate!!!!");
+    TEST_MESSAGE(bumper.alloc<int>(10) == nullptr,
+                 "Should have failed to allocate!!!!");
+    TEST_MESSAGE(bumper.get_num_allocations() == 2,
+                 "Incorrect number of allocations");
+    bumper.dealloc();
+    TEST_MESSAGE(bumper.get_num_allocations() == 1,
+                 "Incorrect number of allocations");
+    bumper.force_dealloc();
+    TEST_MESSAGE(bumper.get_num_allocations() == 0,
+                 "Incorrect number of allocations");
+    TEST_MESSAGE(bumper.alloc<int>(20) != nullptr,
+                 "Failed to allocate after deallocation!!!!");
+}
+
+DEFINE_TEST_G(Test2, ConcurrentBumpUp) {
+    // Fill the arena from several threads with misaligning chars followed by
+    // ints, then check every int is aligned and no two claims overlap
+    constexpr int num_threads = 4;
+    ConcurrentBumpUp<sizeof(int) * 4000> b;
+    std::vector<std::vector<int *>> claimed(num_threads);
+    std::vector<std::thread> threads;
+
+    for (int t = 0; t < num_threads; t++) {
+        threads.emplace_back([&b, &claimed, t] {
+            while (char *c = b.alloc<char>(1)) {
+                *c = 'x';
+                int *i = b.alloc<int>(1);
+                if (!i)
+                    break;
+                *i = t;
+                claimed[t].push_back(i);
+            }
+        });
+    }
+    for (std::thread &thread : threads)
+        thread.join();
+
+    size_t total = 0;
+    for (int t = 0; t < num_threads; t++) {
+        for (int *i : claimed[t]) {
+            TEST_MESSAGE(is_aligned(i, alignof(int)),
+                         "Alignment is incorrect for this type");
+            TEST_MESSAGE(*i == t, "allocation overlaps another thread's");
+        }
+        total += claimed[t].size();
+    }
+    TEST_MESSAGE(total > 0, "Failed to allocate!!!!");
+    TEST_MESSAGE(b.get_num_allocations() >= (int)(2 * total),
+                 "incorrect allocation number");
+}
+
+DEFINE_TEST_G(Test1, BumpChain) {
+    // Outgrow the first chunk and keep allocating
+    BumpChain<20 * sizeof(int)> bumper;
+    int *x = bumper.alloc<int>(20);
+    TEST_MESSAGE(x != nullptr, "Failed to allocate!!!!");
+    int *y = bumper.alloc<int>(20);
+    TEST_MESSAGE(y != nullptr, "Failed to allocate past the first chunk");
+    TEST_MESSAGE(bumper.get_num_chunks() == 2, "Incorrect number of chunks");
+    TEST_MESSAGE(bumper.get_num_allocations() == 2,
+                 "Incorrect number of allocations");
+    x[19] = 1;
+    y[0] = 2;
+    TEST_MESSAGE(x[19] == 1, "incorrect data");
+}
+
+DEFINE_TEST_G(Test2, BumpChain) {
+    // Steady-state loops reuse the cached chunks
+    BumpChain<sizeof(int) * 16> b;
+    int first_round_chunks = 0;
+
+    for (int i = 0; i < 5; i++) {
+        int *first = nullptr;
+        for (int j = 0; j < 200; j++) {
+            b.alloc<char>(1);
+            int *x = b.alloc<int>(1);
+            TEST_MESSAGE(is_aligned(x, alignof(int)),
+                         "Alignment is incorrect for this type");
+            if (!first)
+                first = x;
+        }
+        if (i == 0)
+            first_round_chunks = b.get_num_chunks();
+        TEST_MESSAGE(b.get_num_chunks() == first_round_chunks,
+                     "Allocated new chunks in steady state");
+        TEST_MESSAGE(b.get_num_allocations() == 400,
+                     "incorrect allocation number");
+        b.force_dealloc();
+    }
+}
+
+DEFINE_TEST_G(Test3, BumpChain) {
+    // Oversized requests get their own chunk and leave the chain alone
+    BumpChain<64, FixedGrowth> b;
+    char *small = b.alloc<char>(8);
+    MyClass *big = b.alloc<MyClass>(100);
+    TEST_MESSAGE(big != nullptr, "Failed to allocate!!!!");
+    TEST_MESSAGE(is_aligned(big, alignof(MyClass)),
+                 "Alignment is incorrect for this type");
+    TEST_MESSAGE(b.get_num_chunks() == 2, "Incorrect number of chunks");
+    char *next = b.alloc<char>(8);
+    TEST_MESSAGE(next == small + 8,
+                 "Oversized request should not move the bump pointer");
+    b.force_dealloc();
+    TEST_MESSAGE(b.get_num_chunks() == 1, "Dedicated chunk was not released");
+}
+
+DEFINE_TEST_G(Test1, BumpResource) {
+    // Containers on a pmr resource draw from the arena
+    BumpUp<4096> arena;
+    BumpResource<BumpUp<4096>> resource(arena);
+    {
+        std::pmr::vector<int> v(&resource);
+        for (int i = 0; i < 100; i++)
+            v.push_back(i);
+        TEST_MESSAGE(v[99] == 99, "incorrect data");
+        TEST_MESSAGE(arena.get_num_allocations() == 1,
+                     "Old vector buffers should have been returned");
+
+        std::pmr::string str("a string long enough to skip the SSO buffer",
+                             &resource);
+        TEST_MESSAGE(arena.get_num_allocations() == 2,
+                     "Incorrect number of allocations");
+    }
+    TEST_MESSAGE(arena.get_num_allocations() == 0,
+                 "Containers should have returned everything");
+
+    void *aligned = resource.allocate(8, 64);
+    TEST_MESSAGE(is_aligned(aligned, 64), "Alignment is incorrect");
+}
+
+DEFINE_TEST_G(Test2, BumpResource) {
+    // A full arena surfaces as std::bad_alloc
+    BumpDown<64> arena;
+    BumpResource<BumpDown<64>> resource(arena);
+    bool thrown = false;
+    try {
+        (void)resource.allocate(128, alignof(int));
+    } catch (const std::bad_alloc &) {
+        thrown = true;
+    }
+    TEST_MESSAGE(thrown, "Should have failed to allocate");
+}
+
+DEFINE_TEST_G(Test3, BumpResource) {
+    // The STL adapter rebinds to node types and counts frees
+    using Arena = BumpDown<1 << 14>;
+    using Alloc = BumpAllocator<std::pair<const int, int>, Arena>;
+    Arena arena;
+    {
+        std::unordered_map<int, int, std::hash<int>, std::equal_to<int>, Alloc>
+            map(16, std::hash<int>(), std::equal_to<int>(), Alloc(arena));
+        for (int i = 0; i < 50; i++)
+            map[i] = i * 2;
+        TEST_MESSAGE(map[49] == 98, "incorrect data");
+        TEST_MESSAGE(arena.get_num_allocations() > 50,
+                     "Incorrect number of allocations");
+
+        std::vector<MyClass, BumpAllocator<MyClass, Arena>> v(
+            BumpAllocator<MyClass, Arena>{arena});
+        v.resize(10);
+        TEST_MESSAGE(is_aligned(v.data(), alignof(MyClass)),
+                     "Alignment is incorrect for this type");
+    }
+    TEST_MESSAGE(arena.get_num_allocations() == 0,
+                 "Containers should have returned everything");
+}
+
+// Count the bytes of [p, p + size) that are resident, p being page aligned
+size_t resident_bytes(const void *p, size_t size) {
+    size_t page = sysconf(_SC_PAGESIZE);
+    std::vector<unsigned char> pages((size + page - 1) / page);
+    mincore(const_cast<void *>(p), size, pages.data());
+    size_t resident = 0;
+    for (unsigned char in_core : pages)
+        resident += (in_core & 1) * page;
+    return resident;
+}
+
+DEFINE_TEST_G(Test1, MmapStorage) {
+    // Lazily committed arenas behave like heap backed ones
+    BumpUp<20 * sizeof(int), MmapStorage<>> up;
+    BumpDown<20 * sizeof(int), MmapStorage<>> down;
+    int *x = up.alloc<int>(20);
+    int *y = down.alloc<int>(20);
+    TEST_MESSAGE(x != nullptr && y != nullptr, "Failed to allocate!!!!");
+    TEST_MESSAGE(x[0] == 0 && y[19] == 0,
+                 "Fresh anonymous pages should read as zero");
+    x[19] = 1;
+    y[0] = 2;
+    TEST_MESSAGE(up.alloc<int>(1) == nullptr,
+                 "Should have failed to allocate!!!!");
+    TEST_MESSAGE(down.alloc<int>(1) == nullptr,
+                 "Should have failed to allocate!!!!");
+}
+
+DEFINE_TEST_G(Test2, MmapStorage) {
+    // Huge page requests start on a huge page boundary, and hugetlb falls
+    // back to normal pages when no pool is reserved
+    BumpUp<1 << 20, MmapStorage<MMAP_HUGE_PAGES | MMAP_POPULATE>> thp;
+    BumpDown<1 << 20, MmapStorage<MMAP_HUGETLB>> hugetlb;
+    TEST_MESSAGE(is_aligned(thp.alloc<char>(1), 2 << 20),
+                 "Arena should start on a huge page");
+    TEST_MESSAGE(resident_bytes(thp.data(), 1 << 20) == 1 << 20,
+                 "Populated arena should be resident");
+    char *c = hugetlb.alloc<char>(1 << 20);
+    TEST_MESSAGE(c != nullptr, "Failed to allocate!!!!");
+    c[0] = 'a';
+    c[(1 << 20) - 1] = 'b';
+}
+
+DEFINE_TEST_G(Test1, Arena) {
+    // A caller supplied buffer is used as is and fails when full
+    alignas(int) byte buffer[20 * sizeof(int)];
+    Arena arena(buffer, sizeof(buffer));
+    int *x = arena.alloc<int>(10);
+    TEST_MESSAGE(x == reinterpret_cast<int *>(buffer),
+                 "Should allocate from the caller's buffer");
+    TEST_MESSAGE(arena.alloc<int>(10) != nullptr, "Failed to allocate!!!!");
+    TEST_MESSAGE(arena.alloc<int>(1) == nullptr,
+                 "Should have failed to allocate!!!!");
+    TEST_MESSAGE(arena.get_num_allocations() == 2,
+                 "Incorrect number of allocations");
+    arena.dealloc();
+    arena.dealloc();
+    TEST_MESSAGE(arena.alloc<int>(20) == x,
+                 "Failed to allocate after deallocation!!!!");
+}
+
+DEFINE_TEST_G(Test2, Arena) {
+    // The capacity of an owned buffer comes from a runtime value
+    size_t capacity = 64;
+    Arena arena(capacity);
+    TEST_MESSAGE(arena.capacity() == 64, "Incorrect capacity");
+    char *a1 = arena.alloc<char>(1);
+    MyClass *a2 = arena.alloc<MyClass>(1);
+    TEST_MESSAGE(a1 != nullptr && a2 != nullptr, "Failed to allocate!!!!");
+    TEST_MESSAGE(is_aligned(a2, alignof(MyClass)),
+                 "Alignment is incorrect for this type");
+    TEST_MESSAGE(arena.alloc<char>(64) == nullptr,
+                 "Should have failed to allocate!!!!");
+}
+
+DEFINE_TEST_G(Test3, Arena) {
+    // Inline arenas stay in the object until full, then spill to the heap
+    InlineArena<16 * sizeof(int)> arena;
+    int *x = arena.alloc<int>(16);
+    void *inside = &arena;
+    void *past = &arena + 1;
+    TEST_MESSAGE(x >= inside && x < past,
+                 "Should allocate from the inline buffer");
+    TEST_MESSAGE(!arena.has_spilled(), "Should not have spilled yet");
+
+    int *y = arena.alloc<int>(100);
+    TEST_MESSAGE(y != nullptr, "Failed to spill");
+    TEST_MESSAGE(arena.has_spilled(), "Should have spilled");
+    y[99] = 1;
+    MyClass *z = arena.alloc<MyClass>(1);
+    TEST_MESSAGE(is_aligned(z, alignof(MyClass)),
+                 "Alignment is incorrect for this type");
+    TEST_MESSAGE(arena.get_num_allocations() == 3,
+                 "Incorrect number of allocations");
+
+    // Reset goes back to the inline buffer, the spilled chunk is reused
+    arena.force_dealloc();
+    TEST_MESSAGE(arena.alloc<int>(16) == x, "Should rewind to the buffer");
+    TEST_MESSAGE(arena.alloc<int>(100) == y, "Should reuse the spilled chunk");
+}
+
+DEFINE_TEST_G(Test1, BumpScope) {
+    // Each phase rewinds its scratch memory, so all phases share it
+    BumpUp<64> b;
+    int *outer = b.alloc<int>(1);
+    BumpUp<64>::Checkpoint start = b.mark();
+    int *first_phase = nullptr;
+
+    for (int phase = 0; phase < 3; phase++) {
+        BumpScope<BumpUp<64>> phase_scope(b);
+        int *scratch = b.alloc<int>(4);
+        if (!first_phase)
+            first_phase = scratch;
+        TEST_MESSAGE(scratch == first_phase,
+                     "Each phase should reuse the same memory");
+        {
+            BumpScope<BumpUp<64>> inner_scope(b);
+            TEST_MESSAGE(b.alloc<short>(8) != nullptr,
+                         "Failed to allocate!!!!");
+            TEST_MESSAGE(b.get_num_allocations() == 3,
+                         "Incorrect number of allocations");
+        }
+        TEST_MESSAGE(b.get_num_allocations() == 2,
+                     "Incorrect number of allocations");
+    }
+    TEST_MESSAGE(b.get_num_allocations() == 1,
+                 "Incorrect number of allocations");
+
+    // A checkpoint taken outside the scopes still rewinds everything after it
+    b.alloc<char>(3);
+    b.rewind(start);
+    TEST_MESSAGE(b.alloc<int>(4) == first_phase,
+                 "rewind should restore the bump pointer");
+    TEST_MESSAGE(b.get_num_allocations() == 2,
+                 "Incorrect number of allocations");
+    TEST_MESSAGE(b.alloc<int>(1) > outer, "outer allocation was reclaimed");
+}
+
+DEFINE_TEST_G(Test2, BumpScope) {
+    // Each phase rewinds its scratch memory, so all phases share it
+    BumpDown<64> b;
+    int *outer = b.alloc<int>(1);
+    BumpDown<64>::Checkpoint start = b.mark();
+    int *first_phase = nullptr;
+
+    for (int phase = 0; phase < 3; phase++) {
+        BumpScope<BumpDown<64>> phase_scope(b);
+        int *scratch = b.alloc<int>(4);
+        if (!first_phase)
+            first_phase = scratch;
+        TEST_MESSAGE(scratch == first_phase,
+                     "Each phase should reuse the same memory");
+        {
+            BumpScope<BumpDown<64>> inner_scope(b);
+            TEST_MESSAGE(b.alloc<short>(8) != nullptr,
+                         "Failed to allocate!!!!");
+            TEST_MESSAGE(b.get_num_allocations() == 3,
+                         "Incorrect number of allocations");
+        }
+        TEST_MESSAGE(b.get_num_allocations() == 2,
+                     "Incorrect number of allocations");
+    }
+    TEST_MESSAGE(b.get_num_allocations() == 1,
+                 "Incorrect number of allocations");
+
+    // A checkpoint taken outside the scopes still rewinds everything after it
+    b.alloc<char>(3);
+    b.rewind(start);
+    TEST_MESSAGE(b.alloc<int>(4) == first_phase,
+                 "rewind should restore the bump pointer");
+    TEST_MESSAGE(b.get_num_allocations() == 2,
+                 "Incorrect number of allocations");
+    TEST_MESSAGE(b.alloc<int>(1) < outer, "outer allocation was reclaimed");
+}
+
+// Records the order objects are destroyed in
+std::vector<int> destroyed;
+
+class Tracked {
+  public:
+    Tracked(int id) : id(id) {}
+    ~Tracked() { destroyed.push_back(id); }
+    int id;
+};
+
+DEFINE_TEST_G(Test1, Make) {
+    // Destructors run newest first when the arena is reset
+    destroyed.clear();
+    BumpUp<1024> b;
+    Tracked *t1 = b.make<Tracked>(1);
+    Tracked *t2 = b.make_array<Tracked>(2, 2);
+    Tracked *t3 = b.make<Tracked>(3);
+    TEST_MESSAGE(t1->id == 1 && t2[1].id == 2 && t3->id == 3,
+                 "incorrect data");
+    TEST_MESSAGE(b.get_num_allocations() == 3,
+                 "Incorrect number of allocations");
+    b.force_dealloc();
+    TEST_MESSAGE((destroyed == std::vector<int>{3, 2, 2, 1}),
+                 "Destructors ran in the wrong order");
+}
+
+DEFINE_TEST_G(Test2, Make) {
+    // Trivially destructible types are laid out exactly like alloc
+    BumpUp<1024> b;
+    int *x = b.make<int>(5);
+    int *y = b.make<int>(6);
+    MyClass *z = b.make_array<MyClass>(3);
+    TEST_MESSAGE(*x == 5 && *y == 6, "incorrect data");
+    TEST_MESSAGE(y == x + 1, "Should not store a destructor entry");
+    TEST_MESSAGE(is_aligned(z, alignof(MyClass)),
+                 "Alignment is incorrect for this type");
+    TEST_MESSAGE(b.get_num_allocations() == 3,
+                 "Incorrect number of allocations");
+}
+
+DEFINE_TEST_G(Test3, Make) {
+    // Rewinding and destroying the arena both run destructors
+    destroyed.clear();
+    {
+        BumpDown<1024> b;
+        b.make<Tracked>(1);
+        {
+            BumpScope<BumpDown<1024>> scope(b);
+            b.make<Tracked>(2);
+            b.make<std::string>("a string long enough to skip the SSO buffer");
+        }
+        TEST_MESSAGE((destroyed == std::vector<int>{2}),
+                     "Scope should destroy only its own objects");
+        b.make<Tracked>(3);
+    }
+    TEST_MESSAGE((destroyed == std::vector<int>{2, 3, 1}),
+                 "Destructor should destroy the remaining objects");
+}
+
+DEFINE_TEST_G(Test4, Make) {
+    // Failed allocations leave no entries behind
+    destroyed.clear();
+    BumpDown<sizeof(Tracked) * 4> b;
+    TEST_MESSAGE(b.make_array<Tracked>(8, 1) == nullptr,
+                 "Should have failed to allocate");
+    TEST_MESSAGE(b.get_num_allocations() == 0,
+                 "Incorrect number of allocations");
+    b.force_dealloc();
+    TEST_MESSAGE(destroyed.empty(), "Nothing should have been destroyed");
+}
+
+DEFINE_TEST_G(Test1, Realloc) {
+    // The last allocation grows in place by bumping the pointer
+    BumpUp<32 * sizeof(int)> b;
+    int *x = b.alloc<int>(4);
+    x[3] = 3;
+    TEST_MESSAGE(b.try_extend(x, 4, 16), "Failed to extend in place");
+    TEST_MESSAGE(b.realloc(x, 16, 24) == x, "Should have grown in place");
+    TEST_MESSAGE(x[3] == 3, "incorrect data");
+    TEST_MESSAGE(!b.try_extend(x, 24, 33), "Should not extend past the end");
+    TEST_MESSAGE(b.get_num_allocations() == 1,
+                 "Incorrect number of allocations");
+
+    // Shrinking the last allocation gives the tail back
+    b.shrink(x, 24, 8);
+    TEST_MESSAGE(b.alloc<int>(1) == x + 8, "Tail should be reused");
+}
+
+DEFINE_TEST_G(Test2, Realloc) {
+    // Older allocations are copied out
+    BumpUp<32 * sizeof(int)> b;
+    int *x = b.alloc<int>(4);
+    int *y = b.alloc<int>(4);
+    x[0] = 7;
+    TEST_MESSAGE(!b.try_extend(x, 4, 8), "Only the last allocation can grow");
+    int *moved = b.realloc(x, 4, 8);
+    TEST_MESSAGE(moved == y + 4 && moved[0] == 7, "Should have moved");
+    TEST_MESSAGE(b.get_num_allocations() == 2,
+                 "Incorrect number of allocations");
+    TEST_MESSAGE(b.realloc(moved, 8, 100) == nullptr,
+                 "Should have failed to allocate");
+}
+
+DEFINE_TEST_G(Test3, Realloc) {
+    // The last allocation slides down instead of leaving a dead copy
+    BumpDown<32 * sizeof(int)> b;
+    int *x = b.alloc<int>(4);
+    for (int i = 0; i < 4; i++)
+        x[i] = i;
+    TEST_MESSAGE(!b.try_extend(x, 4, 8), "Should not grow in place");
+    int *grown = b.realloc(x, 4, 8);
+    TEST_MESSAGE(grown == x - 4, "Should have slid down by the growth");
+    TEST_MESSAGE(grown[0] == 0 && grown[3] == 3, "incorrect data");
+    int *shrunk = b.realloc(grown, 8, 2);
+    TEST_MESSAGE(shrunk == x + 2 && shrunk[1] == 1, "Should have slid back up");
+    TEST_MESSAGE(b.get_num_allocations() == 1,
+                 "Incorrect number of allocations");
+    TEST_MESSAGE(b.alloc<int>(1) == shrunk - 1, "Arena should stay compact");
+    TEST_MESSAGE(b.realloc(shrunk, 2, 64) == nullptr,
+                 "Should have failed to allocate");
+
+    // Over-aligned allocations keep their alignment when they slide
+    BumpDown<1024> aligned;
+    float *line = aligned.alloc_aligned<float>(16, 64);
+    line[0] = 1.0f;
+    float *longer = aligned.realloc(line, 16, 20, 64);
+    TEST_MESSAGE(is_aligned(longer, 64) && longer[0] == 1.0f,
+                 "Alignment is incorrect after sliding");
+    float *shorter = aligned.realloc(longer, 20, 3, 64);
+    TEST_MESSAGE(is_aligned(shorter, 64) && shorter[0] == 1.0f,
+                 "Alignment is incorrect after shrinking");
+}
+
+DEFINE_TEST_G(Test1, Aligned) {
+    // Over-aligned requests known at compile time
+    BumpUp<3 * 4096> b;
+    b.alloc<char>(1);
+    float *line = b.alloc_aligned<float, 64>(16);
+    TEST_MESSAGE(is_aligned(line, 64), "Alignment is incorrect for a line");
+    b.alloc<char>(1);
+    double *simd = b.alloc_aligned<double, 32>(4);
+    TEST_MESSAGE(is_aligned(simd, 32), "Alignment is incorrect for AVX2");
+    byte *page = b.alloc_bytes<4096>(4096);
+    TEST_MESSAGE(page != nullptr && is_aligned(page, 4096),
+                 "Alignment is incorrect for a page");
+    TEST_MESSAGE(b.get_num_allocations() == 5,
+                 "Incorrect number of allocations");
+}
+
+DEFINE_TEST_G(Test2, Aligned) {
+    // Alignments only known at runtime
+    BumpDown<4096> b;
+    for (size_t alignment = 1; alignment <= 512; alignment *= 2) {
+        b.alloc<char>(1);
+        char *c = b.alloc_aligned<char>(3, alignment);
+        TEST_MESSAGE(c != nullptr && is_aligned(c, alignment),
+                     "Alignment is incorrect");
+    }
+    int *x = b.alloc_aligned<int>(1, 1);
+    TEST_MESSAGE(is_aligned(x, alignof(int)),
+                 "Alignment below alignof(T) should be raised");
+    TEST_MESSAGE(b.alloc_aligned<int>(1, 24) == nullptr,
+                 "Alignment that is not a power of two should fail");
+    TEST_MESSAGE(b.alloc_aligned<int>(1, 0) == nullptr,
+                 "Zero alignment should fail");
+}
+
+DEFINE_TEST_G(Test3, Aligned) {
+    // Padding for a large alignment still respects the bounds of the buffer,
+    // mmap storage makes both buffers start on a page
+    BumpUp<128, MmapStorage<>> up;
+    BumpDown<128, MmapStorage<>> down;
+    up.alloc<char>(1);
+    TEST_MESSAGE(up.alloc_bytes(1, 4096) == nullptr,
+                 "Should have failed to allocate");
+    TEST_MESSAGE(down.alloc_bytes(100, 4096) != nullptr,
+                 "Failed to allocate!!!!");
+    TEST_MESSAGE(down.alloc_bytes(1, 4096) == nullptr,
+                 "Should have failed to allocate");
+    TEST_MESSAGE(up.get_num_allocations() == 1 &&
+                     down.get_num_allocations() == 1,
+                 "Incorrect number of allocations");
+}
+
+DEFINE_TEST_G(Test1, Stats) {
+    // Mmap storage starts on a page, so the padding is known
+    BumpUp<64, MmapStorage<>, BumpStats> b;
+    b.alloc<char>(1);
+    b.alloc<int>(1);
+    TEST_MESSAGE(b.alloc<char>(100) == nullptr,
+                 "Should have failed to allocate");
+
+    BumpStats::Snapshot s = b.snapshot();
+    TEST_MESSAGE(s.num_allocs == 2 && s.num_failures == 1,
+                 "Incorrect allocation and failure counts");
+    TEST_MESSAGE(s.requested == 5 && s.padding == 3,
+                 "Incorrect requested or padding bytes");
+    TEST_MESSAGE(s.high_water == 8 && b.used() == 8 && b.capacity() == 64,
+                 "Incorrect usage");
+    TEST_MESSAGE(s.histogram[1] == 1 && s.histogram[3] == 1 &&
+                     s.histogram[7] == 1,
+                 "Incorrect size histogram");
+}
+
+DEFINE_TEST_G(Test2, Stats) {
+    // Same as Test1 from the top of the buffer
+    BumpDown<64, MmapStorage<>, BumpStats> b;
+    b.alloc<char>(1);
+    b.alloc<int>(1);
+    TEST_MESSAGE(b.alloc<char>(100) == nullptr,
+                 "Should have failed to allocate");
+
+    BumpStats::Snapshot s = b.snapshot();
+    TEST_MESSAGE(s.num_allocs == 2 && s.num_failures == 1,
+                 "Incorrect allocation and failure counts");
+    TEST_MESSAGE(s.requested == 5 && s.padding == 3,
+                 "Incorrect requested or padding bytes");
+    TEST_MESSAGE(s.high_water == 8 && b.used() == 8 && b.capacity() == 64,
+                 "Incorrect usage");
+    TEST_MESSAGE(s.histogram[1] == 1 && s.histogram[3] == 1 &&
+                     s.histogram[7] == 1,
+                 "Incorrect size histogram");
+}
+
+DEFINE_TEST_G(Test3, Stats) {
+    // The peak survives a reset, growing in place raises it, and the
+    // default policy takes no space
+    BumpUp<1024, HeapStorage, BumpStats> b;
+    int *x = b.alloc<int>(10);
+    b.try_extend(x, 10, 50);
+    b.force_dealloc();
+    b.alloc<int>(1);
+    TEST_MESSAGE(b.snapshot().high_water == 200 && b.used() == 4,
+                 "High water mark should survive force_dealloc");
+    b.reset_stats();
+    TEST_MESSAGE(b.snapshot().high_water == 0 && b.snapshot().num_allocs == 0,
+                 "Stats should be cleared");
+    TEST_MESSAGE(std::is_empty_v<NoStats> &&
+                     sizeof(BumpUp<64>) <
+                         sizeof(BumpUp<64, HeapStorage, BumpStats>),
+                 "NoStats should not add to the allocator's size");
+}
+
+DEFINE_TEST_G(Test4, Stats) {
+    // An object with a destructor entry is recorded as one allocation
+    BumpUp<1024, HeapStorage, BumpStats> up;
+    BumpDown<1024, HeapStorage, BumpStats> down;
+    std::string *a = up.make<std::string>("up");
+    std::string *b = down.make<std::string>("down");
+    std::string *c = down.make_array<std::string>(3, "array");
+    TEST_MESSAGE(a && b && c && *a == "up" && *b == "down" && c[2] == "array",
+                 "Failed to construct!!!!");
+    TEST_MESSAGE(up.snapshot().num_allocs == 1 && up.get_num_allocations() == 1,
+                 "Stats should count the object once");
+    TEST_MESSAGE(down.snapshot().num_allocs == 2 &&
+                     down.get_num_allocations() == 2,
+                 "Stats should count the objects once per call");
+    BumpStats::Snapshot u = up.snapshot();
+    BumpStats::Snapshot d = down.snapshot();
+    TEST_MESSAGE(u.requested + u.padding == up.used() &&
+                     d.requested + d.padding == down.used(),
+                 "Requested bytes should cover the objects and entries");
+}
+
+DEFINE_TEST_G(Test1, Pool) {
+    // Requests go to the smallest class that fits, and freed objects are
+    // reused by the same class
+    BumpUp<4096> arena;
+    SizeClassPool<BumpUp<4096>, 16, 32, 64> pool(arena, 256);
+    void *a = pool.allocate(1);
+    void *b = pool.allocate(24);
+    void *c = pool.allocate(64);
+    TEST_MESSAGE(a && b && c, "Failed to allocate!!!!");
+    TEST_MESSAGE(is_aligned(a, 16) && is_aligned(b, 16) && is_aligned(c, 16),
+                 "Alignment is incorrect");
+    TEST_MESSAGE(pool.allocate(65) == nullptr,
+                 "Larger than every class should fail");
+
+    pool.deallocate(b, 24);
+    TEST_MESSAGE(pool.allocate(17) == b, "Freed object should be reused");
+    TEST_MESSAGE(pool.allocate(24) != b, "Object should not be reused twice");
+    TEST_MESSAGE(pool.get_num_allocations() == 4,
+                 "Incorrect number of allocations");
+}
+
+DEFINE_TEST_G(Test2, Pool) {
+    // Churning objects stays within a small arena
+    BumpUp<1024> arena;
+    SizeClassPool<BumpUp<1024>, 16, 48> pool(arena, 256);
+    int *live[8] = {};
+    bool ok = true;
+    for (int i = 0; i < 10000; i++) {
+        int slot = i % 8;
+        pool.dealloc(live[slot]);
+        live[slot] = pool.alloc<int>();
+        ok &= live[slot] != nullptr;
+        *live[slot] = i;
+    }
+    TEST_MESSAGE(ok, "Failed to allocate!!!!");
+    TEST_MESSAGE(arena.get_num_allocations() == 1,
+                 "Should have used a single slab");
+    TEST_MESSAGE(pool.get_num_allocations() == 8,
+                 "Incorrect number of allocations");
+}
+
+DEFINE_TEST_G(Test3, Pool) {
+    // force_dealloc releases the arena and empties the free lists
+    BumpDown<512> arena;
+    SizeClassPool<BumpDown<512>, 32, 128> pool(arena, 256);
+    void *a = pool.allocate(100);
+    void *b = pool.allocate(100);
+    TEST_MESSAGE(a && b, "Failed to allocate!!!!");
+    TEST_MESSAGE(pool.allocate(10) && pool.allocate(100) == nullptr,
+                 "Should have filled the arena");
+    pool.deallocate(a, 100);
+
+    pool.force_dealloc();
+    TEST_MESSAGE(arena.get_num_allocations() == 0 &&
+                     pool.get_num_allocations() == 0,
+                 "Everything should be released");
+    TEST_MESSAGE(pool.allocate(100) != nullptr && pool.allocate(100) != nullptr,
+                 "Failed to allocate after a reset");
+}
+
+DEFINE_TEST_G(Test4, Pool) {
+    // Resetting the arena directly also empties the free lists and slabs
+    BumpUp<1024> arena;
+    SizeClassPool<BumpUp<1024>, 16, 64> pool(arena, 256);
+    void *a = pool.allocate(16);
+    pool.allocate(16);
+    pool.deallocate(a, 16);
+
+    arena.force_dealloc();
+    char *mine = arena.alloc<char>(512);
+    char *b = static_cast<char *>(pool.allocate(16));
+    char *c = static_cast<char *>(pool.allocate(16));
+    TEST_MESSAGE(mine && b && c, "Failed to allocate!!!!");
+    TEST_MESSAGE((b >= mine + 512 || b + 16 <= mine) &&
+                     (c >= mine + 512 || c + 16 <= mine),
+                 "Pool objects should not overlap the arena's new ones");
+    TEST_MESSAGE(pool.get_num_allocations() == 2,
+                 "Incorrect number of allocations");
+}
+
+DEFINE_TEST_G(Test1, DoubleEnded) {
+    // Both ends share the buffer and stop where they meet
+    DoubleEndedBump<16 * sizeof(int)> b;
+    int *low = b.alloc_up<int>(6);
+    int *high = b.alloc_down<int>(6);
+    TEST_MESSAGE(low && high && low + 6 <= high, "Failed to allocate!!!!");
+    TEST_MESSAGE(is_aligned(low, alignof(int)) &&
+                     is_aligned(high, alignof(int)),
+                 "Alignment is incorrect");
+    TEST_MESSAGE(b.alloc_up<int>(5) == nullptr &&
+                     b.alloc_down<int>(5) == nullptr,
+                 "Should have collided with the other end");
+    TEST_MESSAGE(b.alloc_up<int>(2) && b.alloc_down<int>(2),
+                 "Failed to fill the middle");
+    TEST_MESSAGE(b.available() == 0 && b.get_num_allocations() == 4,
+                 "Buffer should be full");
+}
+
+DEFINE_TEST_G(Test2, DoubleEnded) {
+    // Resetting the scratch end keeps the results at the bottom
+    DoubleEndedBump<64 * sizeof(int)> b;
+    int *results = b.alloc_up<int>(8);
+    for (int i = 0; i < 8; i++)
+        results[i] = i;
+    for (int step = 0; step < 100; step++) {
+        int *scratch = b.alloc_down<int>(48);
+        TEST_MESSAGE(scratch != nullptr, "Failed to allocate!!!!");
+        for (int i = 0; i < 48; i++)
+            scratch[i] = -1;
+        b.reset_down();
+    }
+    bool intact = true;
+    for (int i = 0; i < 8; i++)
+        intact &= results[i] == i;
+    TEST_MESSAGE(intact, "Results were overwritten by scratch");
+    TEST_MESSAGE(b.alloc_down<int>(56) != nullptr,
+                 "Top should reach the bottom's results");
+}
+
+DEFINE_TEST_G(Test3, DoubleEnded) {
+    // Each end counts its own deallocations and the whole buffer is usable
+    // from either end
+    DoubleEndedBump<32> b;
+    b.alloc_up<char>(1);
+    b.alloc_up<char>(1);
+    b.alloc_down<char>(1);
+    b.dealloc_up();
+    TEST_MESSAGE(b.get_num_allocations() == 2,
+                 "Incorrect number of allocations");
+    b.dealloc_up();
+    TEST_MESSAGE(b.available() == 31, "Bottom should have been reset");
+    b.force_dealloc();
+    TEST_MESSAGE(b.alloc_down<char>(32) != nullptr &&
+                     b.alloc_up<char>(1) == nullptr,
+                 "Top should be able to use the whole buffer");
+}
+
+DEFINE_TEST_G(Test1, ThreadArenas) {
+    // Threads running at the same time get separate arenas
+    ThreadArenas<BumpUp<1024>> arenas;
+    std::atomic<int> started(0);
+    int *values[4] = {};
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; t++) {
+        threads.emplace_back([&, t] {
+            values[t] = arenas.alloc<int>(1);
+            *values[t] = t;
+            started++;
+            while (started < 4) {
+            }
+        });
+    }
+    for (std::thread &thread : threads)
+        thread.join();
+
+    bool separate = true;
+    for (int t = 0; t < 4; t++)
+        separate &= values[t] && *values[t] == t;
+    TEST_MESSAGE(separate, "Threads should not share memory");
+    TEST_MESSAGE(arenas.get_num_arenas() == 4, "Each thread needs an arena");
+}
+
+DEFINE_TEST_G(Test2, ThreadArenas) {
+    // Arenas of exited threads are reused
+    ThreadArenas<BumpUp<1024>> arenas;
+    for (int t = 0; t < 10; t++) {
+        std::thread thread([&] { arenas.dealloc(arenas.alloc<int>(4)); });
+        thread.join();
+    }
+    TEST_MESSAGE(arenas.get_num_arenas() == 1,
+                 "Arenas should be recycled after a thread exits");
+    arenas.alloc<int>(1);
+    TEST_MESSAGE(arenas.get_num_arenas() == 1,
+                 "Main thread should reuse the pooled arena");
+}
+
+DEFINE_TEST_G(Test3, ThreadArenas) {
+    // An object freed by another thread is collected by the next owner, and
+    // the arena resets once everything is freed
+    ThreadArenas<BumpUp<1024>> arenas;
+    int *first = nullptr;
+    std::thread producer([&] { first = arenas.alloc<int>(1); });
+    producer.join();
+    arenas.dealloc(first);
+
+    int *second = nullptr;
+    int *reused = nullptr;
+    std::thread consumer([&] {
+        second = arenas.alloc<int>(1);
+        arenas.dealloc(second);
+        reused = arenas.alloc<int>(1);
+    });
+    consumer.join();
+    TEST_MESSAGE(second != first, "Object should still have been allocated");
+    TEST_MESSAGE(reused == first, "Arena should reset after all frees");
+}
+
+DEFINE_TEST_G(Test1, Batch) {
+    // A group of single objects takes one allocation and no padding
+    BumpUp<64> b;
+    auto [i, c1, s, c2] = b.alloc_batch<int, char, short, char>(1, 1, 1, 1);
+    TEST_MESSAGE(i && c1 && s && c2, "Failed to allocate!!!!");
+    TEST_MESSAGE(is_aligned(i, alignof(int)) && is_aligned(s, alignof(short)),
+                 "Alignment is incorrect");
+    *i = 1;
+    *c1 = 2;
+    *s = 3;
+    *c2 = 4;
+    TEST_MESSAGE(*i == 1 && *c1 == 2 && *s == 3 && *c2 == 4,
+                 "Objects overlap");
+    TEST_MESSAGE(b.used() == 8 && b.get_num_allocations() == 1,
+                 "Batch should be one allocation of 8 bytes");
+}
+
+DEFINE_TEST_G(Test2, Batch) {
+    // Arrays from the top, freed with a single dealloc
+    BumpDown<256> b;
+    b.alloc<char>(1);
+    auto [d, c, n] = b.alloc_batch<double, char, int>(3, 5, 2);
+    TEST_MESSAGE(d && c && n, "Failed to allocate!!!!");
+    TEST_MESSAGE(is_aligned(d, alignof(double)) && is_aligned(n, alignof(int)),
+                 "Alignment is incorrect");
+    byte *first = reinterpret_cast<byte *>(d);
+    TEST_MESSAGE(reinterpret_cast<byte *>(n) == first + 3 * sizeof(double) &&
+                     reinterpret_cast<byte *>(c) ==
+                         first + 3 * sizeof(double) + 2 * sizeof(int),
+                 "Arrays should be packed, most aligned first");
+    b.dealloc();
+    b.dealloc();
+    TEST_MESSAGE(b.get_num_allocations() == 0 && b.used() == 0,
+                 "Batch should be freed by one dealloc");
+}
+
+DEFINE_TEST_G(Test3, Batch) {
+    // The whole batch fits or nothing is allocated
+    BumpUp<16> b;
+    auto [n, c] = b.alloc_batch<int, char>(3, 4);
+    TEST_MESSAGE(n && c, "Failed to allocate!!!!");
+    auto [m, e] = b.alloc_batch<int, char>(0, 1);
+    TEST_MESSAGE(!m && !e, "Should have failed to allocate");
+    TEST_MESSAGE(b.get_num_allocations() == 1,
+                 "Failed batch should not be counted");
+}
+
+// Builds a table of squares and sums it with two arena arrays, at compile
+// time when used in a constant expression
+constexpr int sum_of_squares(int n) {
+    ConstArena<int, 32> arena;
+    int *values = arena.alloc(n);
+    int *squares = arena.alloc(n);
+    for (int i = 0; i < n; i++) {
+        values[i] = i;
+        squares[i] = values[i] * values[i];
+    }
+    int sum = 0;
+    for (int i = 0; i < n; i++)
+        sum += squares[i];
+    return sum;
+}
+
+DEFINE_TEST_G(Test1, ConstArena) {
+    // Usable in constant evaluation
+    static_assert(sum_of_squares(10) == 285);
+    constexpr int sum = sum_of_squares(16);
+    TEST_MESSAGE(sum == 1240 && sum_of_squares(16) == sum,
+                 "Compile time and runtime results differ");
+}
+
+DEFINE_TEST_G(Test2, ConstArena) {
+    // Bounds and deallocation work like the other allocators
+    ConstArena<double, 8> arena;
+    TEST_MESSAGE(arena.alloc(5) && arena.alloc(3), "Failed to allocate!!!!");
+    TEST_MESSAGE(arena.alloc(1) == nullptr, "Should have failed to allocate");
+    arena.dealloc();
+    arena.dealloc();
+    TEST_MESSAGE(arena.size() == 0 && arena.alloc(8) != nullptr,
+                 "Arena should be empty after deallocating everything");
+}
+
+DEFINE_TEST_G(Test3, ConstArena) {
+    // A static plan has constant offsets, aligned like BumpUp would place them
+    using Message = StaticArena<64, ArenaSlot<char, 3>, ArenaSlot<int>,
+                                ArenaSlot<short, 4>, ArenaSlot<double>>;
+    static_assert(Message::offset<0>() == 0 && Message::offset<1>() == 4 &&
+                  Message::offset<2>() == 8 && Message::offset<3>() == 16);
+    static_assert(Message::used() == 24 && Message::capacity() == 64);
+
+    Message message;
+    int *n = message.get<1>();
+    double *d = message.get<3>();
+    TEST_MESSAGE(is_aligned(n, alignof(int)) && is_aligned(d, alignof(double)),
+                 "Alignment is incorrect");
+    TEST_MESSAGE(reinterpret_cast<byte *>(d) -
+                         reinterpret_cast<byte *>(message.get<0>()) ==
+                     16,
+                 "Slots should be at their planned offsets");
+}
+
+DEFINE_TEST_G(Test1, Soa) {
+    // Every field array is aligned to a cache line, in a single allocation
+    BumpUp<4096> allocator;
+    auto view = alloc_soa<char, double, int>(allocator, 10);
+    TEST_MESSAGE(view && view.size() == 10, "Failed to allocate!!!!");
+    TEST_MESSAGE(allocator.get_num_allocations() == 1,
+                 "Fields should share one allocation");
+    TEST_MESSAGE(is_aligned(view.field<0>().data(), soa_alignment) &&
+                     is_aligned(view.field<1>().data(), soa_alignment) &&
+                     is_aligned(view.field<2>().data(), soa_alignment),
+                 "Alignment is incorrect");
+    TEST_MESSAGE(reinterpret_cast<byte *>(view.field<2>().data()) -
+                         reinterpret_cast<byte *>(view.field<1>().data()) ==
+                     128,
+                 "Arrays should be rounded up to whole cache lines");
+}
+
+DEFINE_TEST_G(Test2, Soa) {
+    // Element proxies and field spans see the same memory
+    BumpDown<4096> allocator;
+    auto view = alloc_soa<float, float>(allocator, 100);
+    TEST_MESSAGE(view, "Failed to allocate!!!!");
+    for (size_t i = 0; i < view.size(); i++) {
+        auto [x, vx] = view[i];
+        x = i;
+        vx = 2;
+    }
+    for (size_t i = 0; i < view.size(); i++) {
+        auto [x, vx] = view[i];
+        x += vx;
+    }
+    float sum = 0;
+    for (float x : view.field<0>())
+        sum += x;
+    TEST_MESSAGE(sum == 4950 + 200 && view.field<1>()[99] == 2,
+                 "Values do not match");
+}
+
+DEFINE_TEST_G(Test3, Soa) {
+    // A failed allocation gives an empty view and leaves the arena alone
+    BumpUp<320> allocator;
+    auto view = alloc_soa<double, double>(allocator, 32);
+    TEST_MESSAGE(!view && view.size() == 0, "Should have failed to allocate");
+    TEST_MESSAGE(allocator.get_num_allocations() == 0 &&
+                     allocator.used() == 0,
+                 "Failed allocation should not use the arena");
+    auto fitting = alloc_soa<double, double>(allocator, 16);
+    TEST_MESSAGE(fitting, "Arrays with room for alignment should allocate");
+}
+
+DEFINE_TEST_G(Test1, FrameRing) {
+    // Frames rotate through the ring and come back empty
+    FrameRing<BumpUp<1024>, 3> frames;
+    auto &first = frames.next();
+    auto &second = frames.next();
+    auto &third = frames.next();
+    TEST_MESSAGE(&first != &second && &second != &third && &first != &third,
+                 "Every frame should get its own arena");
+    TEST_MESSAGE(first.alloc<int>(10) && second.alloc<int>(10),
+                 "Failed to allocate!!!!");
+
+    frames.release(first);
+    frames.release(second);
+    frames.release(third);
+    auto &fourth = frames.next();
+    TEST_MESSAGE(&fourth == &first && fourth.used() == 0 &&
+                     fourth.get_num_allocations() == 0,
+                 "Released arena should be reused empty");
+    TEST_MESSAGE(frames.get_num_frames() == 4, "Frame count is incorrect");
+    frames.release(fourth);
+
+    // Arenas from elsewhere, and frames already released, are ignored
+    BumpUp<1024> other;
+    int *kept = other.alloc<int>(1);
+    frames.release(other);
+    auto &fifth = frames.next();
+    int *live = fifth.alloc<int>(1);
+    frames.release(fourth);
+    TEST_MESSAGE(other.used() > 0 && kept && live && fifth.used() > 0,
+                 "Only frames in use should be released");
+    frames.release(fifth);
+}
+
+DEFINE_TEST_G(Test2, FrameRing) {
+    // Scrubbing on the worker thread zeroes the memory a frame used
+    FrameRing<BumpDown<1024>, 2, FrameScrub> frames(true);
+    auto &frame = frames.next();
+    int *p = frame.alloc<int>(64);
+    for (int i = 0; i < 64; i++)
+        p[i] = i + 1;
+    frames.release(frame);
+    frames.drain();
+
+    bool zeroed = true;
+    for (int i = 0; i < 64; i++)
+        zeroed &= p[i] == 0;
+    TEST_MESSAGE(zeroed, "Released frame should be scrubbed");
+    TEST_MESSAGE(frame.used() == 0, "Released frame should be reset");
+}
+
+DEFINE_TEST_G(Test3, FrameRing) {
+    // A consumer thread releases frames while the producer builds new ones
+    constexpr int num_requests = 200;
+    FrameRing<BumpUp<8192, MmapStorage<>>, 2, FrameDiscard> frames(true);
+    std::vector<int *> queue(num_requests, nullptr);
+    std::vector<BumpUp<8192, MmapStorage<>> *> owners(num_requests);
+    std::atomic<int> produced(0);
+    std::atomic<int> sum(0);
+
+    std::thread consumer([&] {
+        for (int i = 0; i < num_requests; i++) {
+            while (produced.load(std::memory_order_acquire) <= i)
+                std::this_thread::yield();
+            for (int j = 0; j < 1024; j++)
+                sum.fetch_add(queue[i][j], std::memory_order_relaxed);
+            frames.release(*owners[i]);
+        }
+    });
+    for (int i = 0; i < num_requests; i++) {
+        auto &frame = frames.next();
+        int *request = frame.alloc<int>(1024);
+        for (int j = 0; j < 1024; j++)
+            request[j] = 1;
+        queue[i] = request;
+        owners[i] = &frame;
+        produced.store(i + 1, std::memory_order_release);
+    }
+    consumer.join();
+    frames.drain();
+
+    TEST_MESSAGE(sum == num_requests * 1024, "Values do not match");
+    TEST_MESSAGE(frames.get_num_frames() == num_requests,
+                 "Frame count is incorrect");
+}
+
+DEFINE_TEST_G(Test1, RingBump) {
+    // Releasing in FIFO order keeps a bounded ring going past its end
+    RingBump<256> allocator;
+    bool contiguous = true;
+    for (int i = 0; i < 100; i++) {
+        char *message = allocator.alloc<char>(40);
+        if (!message)
+            break;
+        contiguous &= allocator.owns(message) && allocator.owns(message + 39);
+        if (i >= 2)
+            allocator.release();
+    }
+    TEST_MESSAGE(contiguous, "Allocations should stay inside the buffer");
+    TEST_MESSAGE(allocator.used() <= allocator.capacity() && !allocator.empty(),
+                 "Used memory is incorrect");
+    allocator.release();
+    allocator.release();
+    TEST_MESSAGE(allocator.empty(), "Ring should be empty after releasing");
+}
+
+DEFINE_TEST_G(Test2, RingBump) {
+    // A full ring fails until its oldest allocation is released
+    RingBump<256> allocator;
+    double *first = allocator.alloc<double>(12);
+    double *second = allocator.alloc<double>(12);
+    TEST_MESSAGE(first && second, "Failed to allocate!!!!");
+    TEST_MESSAGE(is_aligned(first, alignof(double)) &&
+                     is_aligned(second, alignof(double)),
+                 "Alignment is incorrect");
+    TEST_MESSAGE(allocator.alloc<double>(12) == nullptr,
+                 "Should have failed to allocate");
+    allocator.release();
+    double *third = allocator.alloc<double>(12);
+    TEST_MESSAGE(third && third < second,
+                 "Released space at the start should be reused");
+    TEST_MESSAGE(allocator.alloc_bytes(16, 256) == nullptr,
+                 "Alignment larger than the ring should fail");
+}
+
+DEFINE_TEST_G(Test3, RingBump) {
+    // Mirrored records straddle the wrap, while a consumer thread releases
+    constexpr size_t size = 1 << 16;
+    RingBump<size, MirroredStorage, true> allocator;
+    char *first = allocator.alloc<char>(size / 2);
+    allocator.release();
+    char *straddling = allocator.alloc<char>(size / 2);
+    TEST_MESSAGE(first && straddling, "Failed to allocate!!!!");
+    straddling[size / 2 - 1] = 'x';
+    TEST_MESSAGE(first[7] == 'x',
+                 "The end of the ring should continue into its start");
+    allocator.release();
+
+    constexpr int num_messages = 20000;
+    std::vector<int *> messages(num_messages, nullptr);
+    std::atomic<int> produced(0);
+    long long sum = 0;
+    std::thread consumer([&] {
+        for (int i = 0; i < num_messages; i++) {
+            while (produced.load(std::memory_order_acquire) <= i)
+                std::this_thread::yield();
+            int *m = messages[i];
+            for (int j = 0; j < 1 + i % 100; j++)
+                sum += m[j];
+            allocator.release();
+        }
+    });
+    for (int i = 0; i < num_messages; i++) {
+        int *m;
+        while (!(m = allocator.alloc<int>(1 + i % 100)))
+            std::this_thread::yield();
+        for (int j = 0; j < 1 + i % 100; j++)
+            m[j] = i;
+        messages[i] = m;
+        produced.store(i + 1, std::memory_order_release);
+    }
+    consumer.join();
+
+    long long expected = 0;
+    for (int i = 0; i < num_messages; i++)
+        expected += (long long)i * (1 + i % 100);
+    TEST_MESSAGE(sum == expected, "Values do not match");
+    TEST_MESSAGE(allocator.empty(), "Ring should be empty after releasing");
+
+    bool thrown = false;
+    try {
+        MirroredStorage odd(size + 100);
+    } catch (const std::invalid_argument &) {
+        thrown = true;
+    }
+    TEST_MESSAGE(thrown, "A size that is not whole pages should be refused");
+}
+
+// Trim in small steps, so the tests can stay small
+struct SmallTrim : TrimDefaults {
+    static constexpr size_t min_trim = 64 << 10;
+};
+
+DEFINE_TEST_G(Test1, Trimming) {
+    // After a spike, pages beyond the steady usage are given back
+    constexpr size_t size = 4 << 20;
+    BumpUp<size, Trimming<MmapStorage<>, SmallTrim>> allocator;
+    byte *p = allocator.alloc<byte>(size);
+    std::memset(p, 1, size);
+    allocator.force_dealloc();
+    TEST_MESSAGE(resident_bytes(p, size) == size,
+                 "A single spike should not be trimmed at once");
+
+    for (int i = 0; i < 50; i++) {
+        std::memset(allocator.alloc<byte>(64 << 10), 1, 64 << 10);
+        allocator.force_dealloc();
+    }
+    TEST_MESSAGE(resident_bytes(p, size) <= 256 << 10,
+                 "Pages beyond the estimate should be released");
+    TEST_MESSAGE(resident_bytes(p, 64 << 10) == 64 << 10,
+                 "Pages in use should stay resident");
+}
+
+DEFINE_TEST_G(Test2, Trimming) {
+    // Usage varying within the headroom never trims, a lasting drop does
+    Trimming<MmapStorage<>, SmallTrim> storage(4 << 20);
+    for (int i = 0; i < 100; i++)
+        storage.reset(i % 2 ? 1 << 20 : 800 << 10, false);
+    TEST_MESSAGE(storage.get_num_trims() == 0,
+                 "Usage within the headroom should not be trimmed");
+    TEST_MESSAGE(storage.get_estimate() >= 800 << 10,
+                 "Estimate should follow the usage");
+
+    for (int i = 0; i < 100; i++)
+        storage.reset(100 << 10, false);
+    TEST_MESSAGE(storage.get_num_trims() > 0 &&
+                     storage.get_estimate() == 100 << 10,
+                 "Estimate should decay to a lasting lower usage");
+}
+
+DEFINE_TEST_G(Test3, Trimming) {
+    // Growing down, the pages released are the ones at the bottom
+    constexpr size_t size = 4 << 20;
+    BumpDown<size, Trimming<MmapStorage<>, SmallTrim>> allocator;
+    byte *p = allocator.alloc<byte>(size);
+    std::memset(p, 1, size);
+    allocator.force_dealloc();
+
+    for (int i = 0; i < 50; i++) {
+        std::memset(allocator.alloc<byte>(64 << 10), 1, 64 << 10);
+        allocator.force_dealloc();
+    }
+    TEST_MESSAGE(resident_bytes(p, size / 2) == 0,
+                 "Pages far from the top should be released");
+    TEST_MESSAGE(resident_bytes(p + size - (64 << 10), 64 << 10) == 64 << 10,
+                 "Pages in use should stay resident");
+}
+
+DEFINE_TEST_G(Test4, Trimming) {
+    // Growing down from an end that is not on a page boundary still trims
+    constexpr size_t size = 4000000;
+    BumpDown<size, Trimming<MmapStorage<>, SmallTrim>> allocator;
+    byte *p = allocator.alloc<byte>(size);
+    std::memset(p, 1, size);
+    allocator.force_dealloc();
+
+    byte *hot = nullptr;
+    for (int i = 0; i < 50; i++) {
+        hot = allocator.alloc<byte>(64 << 10);
+        std::memset(hot, 1, 64 << 10);
+        allocator.force_dealloc();
+    }
+    size_t page = sysconf(_SC_PAGESIZE);
+    byte *hot_page = p + (hot - p) / page * page;
+    TEST_MESSAGE(resident_bytes(p, size / 2) == 0,
+                 "Pages far from the top should be released");
+    TEST_MESSAGE(resident_bytes(hot_page, page) == page,
+                 "Pages in use should stay resident");
+}
+
+DEFINE_TEST_G(Test5, Trimming) {
+    // Both ends of a double-ended arena trim, but never the other's pages
+    constexpr size_t size = 4 << 20;
+    DoubleEndedBump<size, Trimming<MmapStorage<>, SmallTrim>> allocator;
+    byte *top = allocator.alloc_down<byte>(3 << 20);
+    std::memset(top, 1, 3 << 20);
+    allocator.reset_down();
+
+    // The bottom now lives in pages the top used, while the top shrinks
+    byte *bottom = allocator.alloc_up<byte>(2 << 20);
+    std::memset(bottom, 2, 2 << 20);
+    for (int i = 0; i < 50; i++) {
+        std::memset(allocator.alloc_down<byte>(64 << 10), 1, 64 << 10);
+        allocator.reset_down();
+    }
+    bool kept = true;
+    for (size_t i = 0; i < 2 << 20; i++)
+        kept &= bottom[i] == byte{2};
+    TEST_MESSAGE(kept, "Pages in use at the other end should be kept");
+    TEST_MESSAGE(resident_bytes(bottom + (3 << 20), 512 << 10) == 0,
+                 "Pages between the ends should be released");
+
+    for (int i = 0; i < 50; i++) {
+        std::memset(allocator.alloc_up<byte>(64 << 10), 2, 64 << 10);
+        allocator.reset_up();
+    }
+    TEST_MESSAGE(resident_bytes(bottom + (1 << 20), 1 << 20) == 0,
+                 "The bottom should be trimmed as well");
+}
+
+DEFINE_TEST_G(Test1, Numa) {
+    // The topology is read, with at least one node
+    int count = numa_node_count();
+    int node = numa_current_node();
+    TEST_MESSAGE(count >= 1 && count <= numa_max_nodes,
+                 "Node count is incorrect");
+    TEST_MESSAGE(node >= 0 && node < count, "Current node is incorrect");
+}
+
+DEFINE_TEST_G(Test2, Numa) {
+    // Storage is placed on the chosen node, and placements nest
+    int last = numa_node_count() - 1;
+    NumaPlacement outer(last);
+    {
+        NumaPlacement inner(-1);
+        TEST_MESSAGE(NumaPlacement::node() == numa_current_node(),
+                     "Placement should follow the current node");
+    }
+    TEST_MESSAGE(NumaPlacement::node() == last,
+                 "Placement should be restored");
+
+    BumpUp<1 << 20, NumaStorage<>> allocator;
+    char *p = allocator.alloc<char>(4096);
+    TEST_MESSAGE(p, "Failed to allocate!!!!");
+    p[0] = 1;
+    int node = numa_node_of(p);
+    TEST_MESSAGE(node == -1 || node == last,
+                 "Memory should be on the chosen node");
+}
+
+DEFINE_TEST_G(Test3, Numa) {
+    // There is an arena per node, and the local one is the current node's
+    NumaArenas<BumpUp<1 << 16, NumaStorage<>>> arenas;
+    TEST_MESSAGE(arenas.get_num_nodes() == numa_node_count(),
+                 "There should be one arena per node");
+    TEST_MESSAGE(&arenas.on(-1) == &arenas.on(0) &&
+                     &arenas.on(numa_max_nodes) == &arenas.on(0),
+                 "Unknown nodes should fall back to node 0");
+    int *p = arenas.local().alloc<int>(10);
+    TEST_MESSAGE(p && arenas.on(numa_current_node()).owns(p),
+                 "Local arena should be the current node's");
+}
+
+// A linked list that can be saved in a snapshot
+struct SnapshotNode {
+    int value;
+    arena_ptr<SnapshotNode> next;
+};
+
+// A file name of this process for a snapshot
+std::string snapshot_path(const char *name) {
+    return "/tmp/unit_tests_" + std::to_string(getpid()) + "_" + name;
+}
+
+DEFINE_TEST_G(Test1, Snapshot) {
+    // Pointers survive moving the memory they are in
+    BumpUp<1024> allocator;
+    SnapshotNode *nodes = allocator.alloc<SnapshotNode>(3);
+    nodes[0] = {1, &nodes[1]};
+    nodes[1] = {2, &nodes[2]};
+    nodes[2] = {3, nullptr};
+    TEST_MESSAGE(nodes[0].next.get() == &nodes[1] && !nodes[2].next,
+                 "Pointers should point to their targets");
+
+    // Moving the block keeps the distances, copying a pointer keeps its target
+    SnapshotNode *moved = allocator.alloc<SnapshotNode>(3);
+    std::memcpy(static_cast<void *>(moved), nodes, 3 * sizeof(SnapshotNode));
+    arena_ptr<SnapshotNode> copy = nodes[0].next;
+    TEST_MESSAGE(moved[0].next.get() == &moved[1] && moved[1].next->value == 3,
+                 "Moved pointers should follow their block");
+    TEST_MESSAGE(copy.get() == &nodes[1], "Copy should keep its target");
+}
+
+DEFINE_TEST_G(Test2, Snapshot) {
+    // A list saved from one arena is read straight from the mapped file
+    std::string path = snapshot_path("list");
+    {
+        BumpUp<1 << 16> allocator;
+        auto *head = allocator.make<arena_ptr<SnapshotNode>>();
+        for (int i = 0; i < 1000; i++) {
+            SnapshotNode *node = allocator.alloc<SnapshotNode>(1);
+            node->value = i;
+            new (&node->next) arena_ptr<SnapshotNode>(*head);
+            *head = node;
+        }
+        TEST_MESSAGE(save_snapshot(allocator, head, path.c_str()),
+                     "Failed to save the snapshot");
+    }
+
+    Snapshot snapshot(path.c_str());
+    const arena_ptr<SnapshotNode> *head =
+        snapshot.root<arena_ptr<SnapshotNode>>();
+    TEST_MESSAGE(snapshot && head, "Failed to load the snapshot");
+    static_assert(std::is_same_v<decltype(head->get()), const SnapshotNode *>,
+                  "Loaded data should only be reachable as const");
+    int count = 0;
+    long sum = 0;
+    for (const SnapshotNode *node = head->get(); node;
+         node = node->next.get()) {
+        count++;
+        sum += node->value;
+    }
+    TEST_MESSAGE(count == 1000 && sum == 999 * 1000 / 2,
+                 "Values do not match");
+    std::remove(path.c_str());
+}
+
+DEFINE_TEST_G(Test3, Snapshot) {
+    // Alignment is kept across the mapping, and bad files are refused
+    std::string path = snapshot_path("aligned");
+    {
+        BumpDown<4096> allocator;
+        double *values = allocator.alloc_aligned<double>(4, 64);
+        allocator.alloc<char>(3);
+        values[0] = 1.5;
+        TEST_MESSAGE(save_snapshot(allocator, values, path.c_str()),
+                     "Failed to save the snapshot");
+        TEST_MESSAGE(!save_snapshot(allocator, &allocator, path.c_str()),
+                     "Root outside the arena should not be saved");
+    }
+    Snapshot snapshot(path.c_str());
+    const double *values = snapshot.root<double>();
+    TEST_MESSAGE(values && is_aligned(values, 64) && values[0] == 1.5,
+                 "Alignment is incorrect");
+    TEST_MESSAGE(snapshot.root<double[4]>() && !snapshot.root<double[512]>(),
+                 "A root past the end of the data should not load");
+
+    std::ofstream(path, std::ios::trunc) << "not a snapshot";
+    Snapshot bad(path.c_str());
+    Snapshot missing(snapshot_path("missing").c_str());
+    TEST_MESSAGE(!bad && !missing && bad.root<double>() == nullptr,
+                 "Invalid files should not load");
+    std::remove(path.c_str());
+}
+
 int main() {
     bool pass = true;
 
@@ -0,0 +1,405 @@
+#include <allocators/balloc.hpp>
+#include <allocators/r_balloc.hpp>
+#include <allocators/storage.hpp>
+#include <benchmark.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory_resource>
+#include <new>
+#include <random>
+#include <string>
+#include <vector>
+
+// Every allocator is driven through the same small interface:
+//   allocate(size, alignment) returns memory or nullptr,
+//   release(p, size) frees one object if the allocator can,
+//   reset() ends a phase.
+// Allocators that free per object set needs_release, so the workloads only
+// walk their data to free it when that is how the allocator would be used.
+
+struct MallocSource {
+    static constexpr bool needs_release = true;
+    static constexpr const char *name = "malloc/free";
+    void *allocate(size_t size, size_t) { return std::malloc(size); }
+    void release(void *p, size_t) { std::free(p); }
+    void reset() {}
+};
+
+struct NewSource {
+    static constexpr bool needs_release = true;
+    static constexpr const char *name = "new/delete";
+    void *allocate(size_t size, size_t) { return ::operator new(size); }
+    void release(void *p, size_t) { ::operator delete(p); }
+    void reset() {}
+};
+
+constexpr size_t arena_size = (size_t)256 << 20;
+
+// Lazily committed, so the arena only costs the pages a workload touches
+template <class Bump> struct BumpSource {
+    static constexpr bool needs_release = false;
+    Bump arena;
+    void *allocate(size_t size, size_t alignment) {
+        return arena.alloc_bytes(size, alignment);
+    }
+    void release(void *, size_t) {}
+    void reset() { arena.force_dealloc(); }
+};
+
+struct BumpUpSource : BumpSource<BumpUp<arena_size, MmapStorage<>>> {
+    static constexpr const char *name = "BumpUp";
+};
+
+struct BumpDownSource : BumpSource<BumpDown<arena_size, MmapStorage<>>> {
+    static constexpr const char *name = "BumpDown";
+};
+
+struct MonotonicSource {
+    static constexpr bool needs_release = false;
+    static constexpr const char *name = "pmr monotonic";
+    std::pmr::monotonic_buffer_resource resource;
+    void *allocate(size_t size, size_t alignment) {
+        return resource.allocate(size, alignment);
+    }
+    void release(void *, size_t) {}
+    void reset() { resource.release(); }
+};
+
+#ifdef BENCHMARK_HAS_RDTSC
+inline uint64_t ticks() { return __rdtsc(); }
+constexpr const char *tick_unit = "cycles";
+#else
+inline uint64_t ticks() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+constexpr const char *tick_unit = "ns";
+#endif
+
+// Wraps an allocator and times every 16th allocation, so the latency
+// distribution is sampled without timing dominating the run
+template <class Source> struct LatencyProbe {
+    static constexpr bool needs_release = Source::needs_release;
+    Source &source;
+    std::vector<uint64_t> &samples;
+    unsigned counter = 0;
+
+    void *allocate(size_t size, size_t alignment) {
+        if (++counter % 16)
+            return source.allocate(size, alignment);
+        uint64_t t1 = ticks();
+        void *p = source.allocate(size, alignment);
+        do_not_optimize(p);
+        uint64_t t2 = ticks();
+        samples.push_back(t2 - t1);
+        return p;
+    }
+    void release(void *p, size_t size) { source.release(p, size); }
+    void reset() { source.reset(); }
+};
+
+template <class T, class Source> T *make_one(Source &source) {
+    return static_cast<T *>(source.allocate(sizeof(T), alignof(T)));
+}
+
+template <class T, class Source> T *make_many(Source &source, size_t n) {
+    return static_cast<T *>(source.allocate(sizeof(T) * n, alignof(T)));
+}
+
+// Workload 1: build and discard a JSON style document tree
+
+struct JsonNode {
+    int type;
+    double number;
+    char *key;
+    JsonNode **children;
+    int num_children;
+};
+
+template <class Source>
+JsonNode *build_json(Source &source, int depth, int &serial) {
+    JsonNode *node = make_one<JsonNode>(source);
+    char name[32];
+    int length = std::snprintf(name, sizeof(name), "field_%d", serial++);
+    node->key = make_many<char>(source, length + 1);
+    std::memcpy(node->key, name, length + 1);
+    node->number = serial;
+
+    node->num_children = depth ? 2 + serial % 7 : 0;
+    node->type = node->num_children ? 1 : 0;
+    node->children = nullptr;
+    if (node->num_children) {
+        node->children = make_many<JsonNode *>(source, node->num_children);
+        for (int i = 0; i < node->num_children; i++)
+            node->children[i] = build_json(source, depth - 1, serial);
+    }
+    return node;
+}
+
+template <class Source> void free_json(Source &source, JsonNode *node) {
+    for (int i = 0; i < node->num_children; i++)
+        free_json(source, node->children[i]);
+    if (node->children)
+        source.release(node->children, sizeof(JsonNode *) * node->num_children);
+    source.release(node->key, std::strlen(node->key) + 1);
+    source.release(node, sizeof(JsonNode));
+}
+
+template <class Source> void json_phase(Source &source) {
+    int serial = 0;
+    JsonNode *root = build_json(source, 5, serial);
+    do_not_optimize(root);
+    if constexpr (Source::needs_release)
+        free_json(source, root);
+    source.reset();
+}
+
+// Workload 2: build the strings of a response, growing each buffer by
+// doubling the way a string builder would
+
+template <class Source> void strings_phase(Source &source) {
+    static const char *fields[] = {"id", "user", "session", "timestamp",
+                                   "payload", "status", "trace", "region"};
+    std::vector<std::pair<char *, size_t>> built;
+    built.reserve(64);
+
+    for (int s = 0; s < 64; s++) {
+        size_t capacity = 16;
+        size_t size = 0;
+        char *buffer = make_many<char>(source, capacity);
+        for (int f = 0; f < 40; f++) {
+            const char *field = fields[(s + f) % 8];
+            size_t length = std::strlen(field);
+            while (size + length + 2 > capacity) {
+                char *grown = make_many<char>(source, capacity * 2);
+                std::memcpy(grown, buffer, size);
+                source.release(buffer, capacity);
+                buffer = grown;
+                capacity *= 2;
+            }
+            std::memcpy(buffer + size, field, length);
+            size += length;
+            buffer[size++] = ';';
+        }
+        buffer[size] = '\0';
+        built.push_back({buffer, capacity});
+    }
+    do_not_optimize(built);
+
+    if constexpr (Source::needs_release)
+        for (auto &[buffer, capacity] : built)
+            source.release(buffer, capacity);
+    source.reset();
+}
+
+// Workload 3: allocate the nodes and adjacency lists of a random graph
+
+struct GraphNode {
+    int id;
+    int degree;
+    GraphNode **edges;
+};
+
+std::vector<int> graph_degrees;
+
+template <class Source> void graph_phase(Source &source) {
+    size_t n = graph_degrees.size();
+    GraphNode **nodes = make_many<GraphNode *>(source, n);
+    for (size_t i = 0; i < n; i++) {
+        GraphNode *node = make_one<GraphNode>(source);
+        node->id = i;
+        node->degree = graph_degrees[i];
+        node->edges = make_many<GraphNode *>(source, node->degree);
+        nodes[i] = node;
+    }
+    for (size_t i = 0; i < n; i++)
+        for (int e = 0; e < nodes[i]->degree; e++)
+            nodes[i]->edges[e] = nodes[(i * 31 + e * 17) % n];
+    do_not_optimize(nodes);
+
+    if constexpr (Source::needs_release) {
+        for (size_t i = 0; i < n; i++) {
+            source.release(nodes[i]->edges,
+                           sizeof(GraphNode *) * nodes[i]->degree);
+            source.release(nodes[i], sizeof(GraphNode));
+        }
+        source.release(nodes, sizeof(GraphNode *) * n);
+    }
+    source.reset();
+}
+
+// Workload 4: batches of mixed sizes drawn from a recorded distribution.
+// The table is an allocation size profile of a request handling service:
+// mostly small objects, a tail of buffers up to a few pages.
+
+struct SizeClass {
+    size_t size;
+    double weight;
+};
+
+const SizeClass recorded_sizes[] = {
+    {8, 9.0},    {16, 22.0},   {24, 14.0},   {32, 16.0},  {48, 9.0},
+    {64, 8.0},   {96, 5.0},    {128, 5.0},   {256, 4.0},  {512, 3.0},
+    {1024, 2.5}, {2048, 1.2},  {4096, 0.8},  {16384, 0.3}, {65536, 0.2},
+};
+
+std::vector<size_t> mixed_sizes;
+
+template <class Source> void mixed_phase(Source &source) {
+    std::vector<void *> live;
+    live.reserve(mixed_sizes.size());
+    for (size_t size : mixed_sizes) {
+        void *p = source.allocate(size, alignof(std::max_align_t));
+        std::memset(p, 0, size < 64 ? size : 64);
+        live.push_back(p);
+    }
+    do_not_optimize(live);
+
+    if constexpr (Source::needs_release)
+        for (size_t i = 0; i < live.size(); i++)
+            source.release(live[i], mixed_sizes[i]);
+    source.reset();
+}
+
+void prepare_inputs() {
+    std::mt19937 rng(42);
+
+    std::uniform_int_distribution<int> degree(1, 16);
+    graph_degrees.resize(4000);
+    for (int &d : graph_degrees)
+        d = degree(rng);
+
+    std::vector<double> weights;
+    for (const SizeClass &c : recorded_sizes)
+        weights.push_back(c.weight);
+    std::discrete_distribution<size_t> pick(weights.begin(), weights.end());
+    mixed_sizes.resize(20000);
+    for (size_t &size : mixed_sizes)
+        size = recorded_sizes[pick(rng)].size;
+}
+
+// Peak RSS of the process in KB, reset between measurements through
+// /proc/self/clear_refs where the kernel allows it
+
+bool reset_peak_rss() {
+    std::ofstream clear("/proc/self/clear_refs");
+    clear << "5";
+    return bool(clear.flush());
+}
+
+long read_status_kb(const char *field) {
+    std::ifstream status("/proc/self/status");
+    std::string line;
+    while (std::getline(status, line))
+        if (line.compare(0, std::strlen(field), field) == 0)
+            return std::atol(line.c_str() + std::strlen(field));
+    return -1;
+}
+
+struct Report {
+    const char *name;
+    double phases_per_second;
+    long peak_rss_kb;
+    uint64_t p50;
+    uint64_t p99;
+};
+
+std::vector<Report> reports;
+
+template <class Source, class Phase>
+void run_workload(Benchmark &b, Phase phase) {
+    Report report{Source::name, 0, -1, 0, 0};
+
+    // Peak RSS above the baseline while one allocator runs the phase
+    {
+        bool can_reset = reset_peak_rss();
+        long baseline = read_status_kb("VmRSS:");
+        Source *source = new Source();
+        for (int i = 0; i < 20; i++)
+            phase(*source);
+        long peak = read_status_kb("VmHWM:");
+        delete source;
+        if (can_reset && baseline >= 0 && peak >= 0)
+            report.peak_rss_kb = peak - baseline;
+    }
+
+    // Throughput, through the common harness
+    Source *source = new Source();
+    b.benchmark(Source::name, [&] { phase(*source); });
+    delete source;
+
+    // Allocation latency, sampled on a separate run
+    {
+        std::vector<uint64_t> samples;
+        Source *source = new Source();
+        LatencyProbe<Source> probe{*source, samples};
+        for (int i = 0; i < 20; i++)
+            phase(probe);
+        delete source;
+        if (!samples.empty()) {
+            std::sort(samples.begin(), samples.end());
+            report.p50 = samples[samples.size() / 2];
+            report.p99 = samples[samples.size() * 99 / 100];
+        }
+    }
+
+    reports.push_back(report);
+}
+
+void print_reports(Benchmark &b) {
+    b.print();
+
+    const int column_width = 15;
+    std::cout << std::left << std::setw(column_width) << "Allocator"
+              << std::setw(column_width) << "Phases/s"
+              << std::setw(column_width) << "Peak RSS (KB)"
+              << std::setw(column_width)
+              << (std::string("p50 (") + tick_unit + ")")
+              << (std::string("p99 (") + tick_unit + ")") << std::endl;
+    for (const Report &r : reports) {
+        std::cout << std::left << std::setw(column_width) << r.name
+                  << std::fixed << std::setprecision(1)
+                  << std::setw(column_width) << r.phases_per_second
+                  << std::setw(column_width);
+        if (r.peak_rss_kb >= 0)
+            std::cout << r.peak_rss_kb;
+        else
+            std::cout << "n/a";
+        std::cout << std::setw(column_width) << r.p50 << r.p99 << std::endl;
+    }
+    std::cout << std::endl;
+    reports.clear();
+}
+
+template <class Phase> void run_suite(const char *title, Phase phase) {
+    std::cout << "== " << title << " ==" << std::endl;
+    Benchmark b(200);
+    b.warmup(20);
+    run_workload<MallocSource>(b, [&](auto &s) { phase(s); });
+    run_workload<NewSource>(b, [&](auto &s) { phase(s); });
+    run_workload<MonotonicSource>(b, [&](auto &s) { phase(s); });
+    run_workload<BumpUpSource>(b, [&](auto &s) { phase(s); });
+    run_workload<BumpDownSource>(b, [&](auto &s) { phase(s); });
+    for (size_t i = 0; i < reports.size(); i++)
+        reports[i].phases_per_second = 1000.0 / b.get_mean(i);
+    print_reports(b);
+}
+
+int main() {
+    prepare_inputs();
+
+    run_suite("json tree", [](auto &s) { json_phase(s); });
+    run_suite("request strings", [](auto &s) { strings_phase(s); });
+    run_suite("graph nodes", [](auto &s) { graph_phase(s); });
+    run_suite("mixed sizes", [](auto &s) { mixed_phase(s); });
+
+    return 0;
+}